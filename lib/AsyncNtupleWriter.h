@@ -0,0 +1,138 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "TROOT.h"
+#include "TFile.h"
+#include "TTree.h"
+
+#include "ErrorHandler.h"
+
+//writes rows of float columns into the TTree in a background thread
+//rows are collected into blocks; the full blocks are passed to the thread
+//that owns the output file so the filling thread never waits for the compression and I/O
+//the thread waits only when the queue already holds max_queued_blocks blocks
+class AsyncNtupleWriter
+{
+	private:
+	std::string file_name, tree_name;
+	std::vector<std::string> columns;
+	int compression;
+
+	unsigned long block_size;
+	unsigned long max_queued_blocks;
+
+	//block that is currently filled with rows of columns.size() values each
+	std::vector<float> block;
+	std::deque<std::vector<float>> queue;
+
+	std::mutex mutex;
+	std::condition_variable queue_cv;
+	bool is_closed = false;
+
+	std::thread writer;
+
+	unsigned long nrows = 0;
+
+	void Write()
+	{
+		TFile file(file_name.c_str(), "RECREATE", "", compression);
+		if (!file.IsOpen()) PrintError("File " + file_name + " cannot be created");
+
+		TTree tree(tree_name.c_str(), tree_name.c_str());
+		std::vector<float> row(columns.size());
+		for (unsigned long i = 0; i < columns.size(); i++)
+		{
+			tree.Branch(columns[i].c_str(), &row[i], (columns[i] + "/F").c_str());
+		}
+
+		while (true)
+		{
+			std::vector<float> rows;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				queue_cv.wait(lock, [this] {return !queue.empty() || is_closed;});
+				if (queue.empty()) break;
+				rows = std::move(queue.front());
+				queue.pop_front();
+			}
+			queue_cv.notify_all();
+
+			for (unsigned long i = 0; i < rows.size(); i += columns.size())
+			{
+				std::copy(rows.begin() + i, rows.begin() + i + columns.size(), row.begin());
+				tree.Fill();
+			}
+		}
+
+		file.cd();
+		tree.Write();
+		file.Close();
+	}
+
+	void PushBlock()
+	{
+		if (block.empty()) return;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			queue_cv.wait(lock, [this] {return queue.size() < max_queued_blocks;});
+			queue.push_back(std::move(block));
+		}
+		queue_cv.notify_all();
+		block = std::vector<float>();
+		block.reserve(block_size*columns.size());
+	}
+
+	public :
+
+	//compression is passed to TFile: 100*algorithm + level; 505 is ZSTD with level 5
+	AsyncNtupleWriter(std::string output_file_name, std::string name,
+		std::vector<std::string> column_names, const int compression_settings = 505,
+		const unsigned long rows_per_block = 4096, const unsigned long max_blocks = 16)
+	{
+		file_name = output_file_name;
+		tree_name = name;
+		columns = column_names;
+		compression = compression_settings;
+		block_size = rows_per_block;
+		max_queued_blocks = max_blocks;
+
+		block.reserve(block_size*columns.size());
+
+		//the file is owned by another thread while the main thread keeps using ROOT
+		ROOT::EnableThreadSafety();
+		writer = std::thread(&AsyncNtupleWriter::Write, this);
+	}
+
+	~AsyncNtupleWriter() {Close();}
+
+	//row must contain the values of all columns in the order they were passed to the constructor
+	void Fill(const std::vector<float> &row)
+	{
+		block.insert(block.end(), row.begin(), row.end());
+		nrows++;
+		if (block.size() >= block_size*columns.size()) PushBlock();
+	}
+
+	//passes the remaining rows to the thread and waits until the file is written
+	void Close()
+	{
+		if (!writer.joinable()) return;
+		PushBlock();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			is_closed = true;
+		}
+		queue_cv.notify_all();
+		writer.join();
+	}
+
+	unsigned long GetNcolumns() const {return columns.size();}
+	unsigned long GetNrows() const {return nrows;}
+	std::string GetFileName() const {return file_name;}
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+//acceptances (ptmin, |ymax|) of up to 64 cut sets evaluated at once: the cuts are stored as arrays
+//and the acceptance of the object is the bit mask with the bit c set if the cut set c accepts it
+//so the loops over the cut sets have no branches and adding a cut set costs a few operations per object
+class CutSets
+{
+	private:
+	std::vector<double> ptmin, abs_max_y;
+
+	public :
+
+	static constexpr unsigned long max_size = 64;
+
+	CutSets() {};
+
+	//returns false if there are already max_size cut sets
+	bool Add(const double cut_ptmin, const double cut_abs_max_y)
+	{
+		if (ptmin.size() >= max_size) return false;
+		ptmin.push_back(cut_ptmin);
+		abs_max_y.push_back(cut_abs_max_y);
+		return true;
+	}
+
+	//the objects are sampled or selected in the widest acceptance so the cut sets that are as wide
+	//as it in pT or in |y| accept every object in this variable independently of the rounding at the edges
+	void SetWidestAcceptance()
+	{
+		const double min_ptmin = GetMinPtmin();
+		const double max_abs_max_y = GetMaxAbsMaxY();
+		for (unsigned long c = 0; c < ptmin.size(); c++)
+		{
+			if (ptmin[c] <= min_ptmin) ptmin[c] = -std::numeric_limits<double>::infinity();
+			if (abs_max_y[c] >= max_abs_max_y) abs_max_y[c] = std::numeric_limits<double>::infinity();
+		}
+	}
+
+	unsigned long GetSize() const {return ptmin.size();}
+	double GetPtmin(const unsigned long c) const {return ptmin[c];}
+	double GetAbsMaxY(const unsigned long c) const {return abs_max_y[c];}
+
+	double GetMinPtmin() const
+	{
+		double result = std::numeric_limits<double>::infinity();
+		for (const double value : ptmin) result = std::min(result, value);
+		return result;
+	}
+
+	double GetMaxAbsMaxY() const
+	{
+		double result = 0.;
+		for (const double value : abs_max_y) result = std::max(result, value);
+		return result;
+	}
+
+	//mask of the cut sets with pT >= ptmin
+	uint64_t GetPtMask(const double pt) const
+	{
+		uint64_t mask = 0;
+		for (unsigned long c = 0; c < ptmin.size(); c++) mask |= static_cast<uint64_t>(pt >= ptmin[c]) << c;
+		return mask;
+	}
+
+	//mask of the cut sets with |y| <= |ymax|
+	uint64_t GetYMask(const double y) const
+	{
+		const double abs_y = fabs(y);
+		uint64_t mask = 0;
+		for (unsigned long c = 0; c < abs_max_y.size(); c++)
+		{
+			mask |= static_cast<uint64_t>(abs_y <= abs_max_y[c]) << c;
+		}
+		return mask;
+	}
+
+	//index of the lowest cut set in the mask; the mask must not be 0
+	//the cut sets of the mask are iterated as for (; mask; mask &= mask - 1) GetFirst(mask)
+	static unsigned int GetFirst(const uint64_t mask) {return __builtin_ctzll(mask);}
+
+	//suffix of the names of the histograms of the cut set e.g. _ptmin50_ymax2.5
+	static std::string GetSuffix(const double cut_ptmin, const double cut_abs_max_y)
+	{
+		std::stringstream suffix;
+		suffix << "_ptmin" << cut_ptmin << "_ymax" << cut_abs_max_y;
+		return suffix.str();
+	}
+};
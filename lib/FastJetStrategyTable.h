@@ -0,0 +1,171 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <array>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <chrono>
+
+#include "fastjet/PseudoJet.hh"
+#include "fastjet/ClusterSequence.hh"
+#include "fastjet/Error.hh"
+
+//fastjet clustering strategy chosen by the number of input particles from the clustering times
+//measured on this machine: every multiplicity bin (half of an octave) keeps the mean time per event
+//of every candidate strategy and the events in the bin are clustered with the fastest one
+//the bins without measurements use the nearest measured bin; the table is written as text lines
+//"<bin> <min multiplicity> <time of every strategy in microseconds>" where -1 means not available
+//(e.g. NlnN without CGAL) and 0 means not measured
+class FastJetStrategyTable
+{
+	public :
+
+	static constexpr unsigned int nstrategies = 3;
+	static constexpr std::array<fastjet::Strategy, nstrategies> strategies =
+		{fastjet::N2Plain, fastjet::N2Tiled, fastjet::NlnN};
+	static constexpr std::array<const char *, nstrategies> strategy_names = {"N2Plain", "N2Tiled", "NlnN"};
+
+	private:
+
+	//mean clustering time per event in microseconds with index [bin][strategy]
+	std::vector<std::array<double, nstrategies>> times;
+	//index of the strategy used in every bin or -1 if no bin is measured
+	std::vector<int> best;
+
+	//index of the fastest available strategy of the bin or -1 if there is none
+	int GetFastest(const unsigned int bin) const
+	{
+		int fastest = -1;
+		for (unsigned int s = 0; s < nstrategies; s++)
+		{
+			if (times[bin][s] <= 0.) continue;
+			if (fastest < 0 || times[bin][s] < times[bin][fastest]) fastest = s;
+		}
+		return fastest;
+	}
+
+	//the unmeasured bins take the strategy of the nearest measured bin (the lower one on the tie)
+	void UpdateBest()
+	{
+		best.assign(times.size(), -1);
+		for (unsigned int bin = 0; bin < times.size(); bin++)
+		{
+			for (unsigned int distance = 0; distance < times.size(); distance++)
+			{
+				if (bin >= distance && GetFastest(bin - distance) >= 0)
+				{
+					best[bin] = GetFastest(bin - distance);
+					break;
+				}
+				if (bin + distance < times.size() && GetFastest(bin + distance) >= 0)
+				{
+					best[bin] = GetFastest(bin + distance);
+					break;
+				}
+			}
+		}
+	}
+
+	public :
+
+	FastJetStrategyTable() {};
+
+	//bin b contains the multiplicities in [2^(b/2), 2^((b+1)/2))
+	static unsigned int GetBin(const unsigned long multiplicity)
+	{
+		if (multiplicity < 2) return 0;
+		return static_cast<unsigned int>(2.*log2(static_cast<double>(multiplicity)));
+	}
+
+	static unsigned long GetMinMultiplicity(const unsigned int bin) {return ceil(pow(2., bin/2.));}
+
+	unsigned int GetNbins() const {return times.size();}
+	bool IsEmpty() const {return best.size() == 0 || best[0] < 0;}
+
+	//time in microseconds; -1 marks the strategy that is not available
+	void SetTime(const unsigned int bin, const unsigned int strategy, const double time)
+	{
+		if (bin >= times.size()) times.resize(bin + 1, std::array<double, nstrategies>{});
+		times[bin][strategy] = time;
+		UpdateBest();
+	}
+
+	double GetTime(const unsigned int bin, const unsigned int strategy) const {return times[bin][strategy];}
+
+	//index of the strategy for the multiplicity or -1 if the table is empty
+	int GetStrategyIndex(const unsigned long multiplicity) const
+	{
+		if (best.size() == 0) return -1;
+		const unsigned int bin = GetBin(multiplicity);
+		return (bin < best.size()) ? best[bin] : best.back();
+	}
+
+	//returns false if the file cannot be read
+	bool Read(const std::string &file_name)
+	{
+		std::ifstream file(file_name);
+		if (!file.is_open()) return false;
+
+		times.clear();
+		for (std::string line; std::getline(file, line);)
+		{
+			if (line.size() == 0 || line[0] == '#') continue;
+			std::stringstream stream(line);
+			unsigned int bin;
+			unsigned long min_multiplicity;
+			std::array<double, nstrategies> bin_times;
+			stream >> bin >> min_multiplicity;
+			for (double &time : bin_times) stream >> time;
+			if (stream.fail()) return false;
+
+			if (bin >= times.size()) times.resize(bin + 1, std::array<double, nstrategies>{});
+			times[bin] = bin_times;
+		}
+		UpdateBest();
+		return true;
+	}
+
+	//returns false if the file cannot be created
+	bool Write(const std::string &file_name) const
+	{
+		std::ofstream file(file_name);
+		if (!file.is_open()) return false;
+
+		file << "# bin, min multiplicity, time per event in microseconds:";
+		for (const char *name : strategy_names) file << " " << name;
+		file << std::endl;
+		for (unsigned int bin = 0; bin < times.size(); bin++)
+		{
+			if (GetFastest(bin) < 0) continue;
+			file << bin << " " << GetMinMultiplicity(bin);
+			for (const double time : times[bin]) file << " " << time;
+			file << std::endl;
+		}
+		return true;
+	}
+
+	//mean time in microseconds of the clustering of the input and of the extraction of the inclusive jets
+	//the clustering is repeated until it takes at least min_time seconds; returns -1 if fastjet
+	//does not support the strategy of jet_def
+	static double MeasureTime(const std::vector<fastjet::PseudoJet> &input,
+		const fastjet::JetDefinition &jet_def, const double jet_ptmin, const double min_time)
+	{
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		double time = 0.;
+		unsigned long nrepeats = 0;
+		try
+		{
+			while (time < min_time)
+			{
+				fastjet::ClusterSequence cluster_seq(input, jet_def);
+				const std::vector<fastjet::PseudoJet> jets = cluster_seq.inclusive_jets(jet_ptmin);
+				nrepeats++;
+				time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			}
+		}
+		catch (const fastjet::Error &error) {return -1.;}
+		return time/static_cast<double>(nrepeats)*1e6;
+	}
+};
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "TH1D.h"
+
+//histogram with uniform bins that is filled with many weights per entry at once
+//the bin is searched only once per fill and the contents for all weights
+//of the same bin are stored next to each other so the loop over weights is vectorized
+class MultiWeightHist
+{
+	private:
+	std::string name, title;
+
+	int nbins;
+	double xmin, xmax;
+	double inv_bin_width;
+
+	int nweights;
+
+	//sums of weights and of squared weights with index [bin*nweights + weight index]
+	//bins include underflow (0) and overflow (nbins + 1) in the same way as in TH1
+	std::vector<double> sumw, sumw2;
+
+	public :
+
+	MultiWeightHist() {};
+
+	MultiWeightHist(std::string hist_name, std::string hist_title, const int number_of_bins,
+		const double low_edge, const double up_edge, const int number_of_weights = 1)
+	{
+		name = hist_name;
+		title = hist_title;
+		nbins = number_of_bins;
+		xmin = low_edge;
+		xmax = up_edge;
+		inv_bin_width = static_cast<double>(nbins)/(xmax - xmin);
+		nweights = number_of_weights;
+
+		sumw.assign((nbins + 2)*nweights, 0.);
+		sumw2.assign((nbins + 2)*nweights, 0.);
+	}
+
+	int FindBin(const double x) const
+	{
+		if (x < xmin) return 0;
+		if (x >= xmax) return nbins + 1;
+		return std::min(static_cast<int>((x - xmin)*inv_bin_width), nbins - 1) + 1;
+	}
+
+	//weights must point to the array of nweights values
+	void Fill(const double x, const double *weights)
+	{
+		const int offset = FindBin(x)*nweights;
+		double *w = &sumw[offset];
+		double *w2 = &sumw2[offset];
+
+		for (int i = 0; i < nweights; i++)
+		{
+			w[i] += weights[i];
+			w2[i] += weights[i]*weights[i];
+		}
+	}
+
+	void Fill(const double x, const std::vector<double> &weights) {Fill(x, weights.data());}
+
+	//adds contents of another histogram with the same binning and number of weights
+	void Add(const MultiWeightHist &hist, const double scale = 1.)
+	{
+		for (unsigned long i = 0; i < sumw.size(); i++)
+		{
+			sumw[i] += hist.sumw[i]*scale;
+			sumw2[i] += hist.sumw2[i]*scale*scale;
+		}
+	}
+
+	void Scale(const double scale)
+	{
+		for (unsigned long i = 0; i < sumw.size(); i++)
+		{
+			sumw[i] *= scale;
+			sumw2[i] *= scale*scale;
+		}
+	}
+
+	void Reset()
+	{
+		std::fill(sumw.begin(), sumw.end(), 0.);
+		std::fill(sumw2.begin(), sumw2.end(), 0.);
+	}
+
+	double GetBinContent(const int bin, const int weight_index = 0) const
+	{
+		return sumw[bin*nweights + weight_index];
+	}
+
+	double GetBinError(const int bin, const int weight_index = 0) const
+	{
+		return sqrt(sumw2[bin*nweights + weight_index]);
+	}
+
+	double GetBinCenter(const int bin) const
+	{
+		return xmin + (static_cast<double>(bin) - 0.5)/inv_bin_width;
+	}
+
+	double GetBinWidth() const {return 1./inv_bin_width;}
+	double GetXmin() const {return xmin;}
+	double GetXmax() const {return xmax;}
+	int GetNbins() const {return nbins;}
+	int GetNweights() const {return nweights;}
+	std::string GetName() const {return name;}
+
+	//returns TH1D for the given weight; name suffix is appended to the name of the histogram
+	TH1D GetTH1D(const int weight_index = 0, std::string name_suffix = "", std::string title_suffix = "") const
+	{
+		TH1D hist = TH1D((name + name_suffix).c_str(), (title + title_suffix).c_str(), nbins, xmin, xmax);
+		hist.Sumw2();
+		for (int i = 0; i <= nbins + 1; i++)
+		{
+			hist.SetBinContent(i, GetBinContent(i, weight_index));
+			hist.SetBinError(i, GetBinError(i, weight_index));
+		}
+		return hist;
+	}
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cmath>
+
+//mappings of the uniform number u in [0, 1) into the integration variable x
+//Map returns x and sets jacobian = dx/du so that the integral of f(x) dx
+//is estimated as the average of f(x(u))*jacobian over uniform u
+
+//uniform x in [min, max]
+class UniformMap
+{
+	private:
+	double min, max;
+
+	public :
+
+	UniformMap(const double min_value, const double max_value)
+	{
+		min = min_value;
+		max = max_value;
+	}
+
+	//true if the range is empty; the integral over it is 0
+	bool IsEmpty() const {return max <= min;}
+
+	double Map(const double u, double &jacobian) const
+	{
+		jacobian = max - min;
+		return min + u*(max - min);
+	}
+};
+
+//x in [min, max] distributed as x^(-power); used for the steeply falling pT spectra
+class PowerLawMap
+{
+	private:
+	double min, max, power;
+	//min^(1 - power) and max^(1 - power) - min^(1 - power)
+	double min_pow, range_pow;
+
+	public :
+
+	PowerLawMap(const double min_value, const double max_value, const double power_value)
+	{
+		min = min_value;
+		max = max_value;
+		power = power_value;
+
+		if (power == 1.)
+		{
+			min_pow = log(min);
+			range_pow = log(max) - log(min);
+		}
+		else
+		{
+			min_pow = pow(min, 1. - power);
+			range_pow = pow(max, 1. - power) - min_pow;
+		}
+	}
+
+	bool IsEmpty() const {return max <= min;}
+
+	double Map(const double u, double &jacobian) const
+	{
+		if (power == 1.)
+		{
+			const double x = exp(min_pow + u*range_pow);
+			jacobian = range_pow*x;
+			return x;
+		}
+		const double x = pow(min_pow + u*range_pow, 1./(1. - power));
+		jacobian = range_pow/(1. - power)*pow(x, power);
+		return x;
+	}
+};
+
+//kinematic limits of 2->2 massless scattering with the partons rapidities y1, y2
+//and xT = 2pT/sqrt(s) where x1 = xT/2*(exp(y1) + exp(y2)) and x2 = xT/2*(exp(-y1) + exp(-y2))
+namespace DijetKinematics
+{
+	//maximum |y1| at which there is y2 with x1 <= 1 and x2 <= 1
+	double MaxRapidity(const double xt)
+	{
+		if (xt >= 1.) return 0.;
+		return acosh(1./xt);
+	}
+
+	//range of y2 at which x1 <= 1 and x2 <= 1 for the given y1
+	//the range is empty (y2min > y2max) if |y1| is larger than MaxRapidity
+	void Y2Range(const double xt, const double y1, double &y2min, double &y2max)
+	{
+		const double max_exp = 2./xt - exp(y1);
+		const double min_exp = 2./xt - exp(-y1);
+		if (max_exp <= 0. || min_exp <= 0.)
+		{
+			y2min = 0.;
+			y2max = -1.;
+			return;
+		}
+		y2max = log(max_exp);
+		y2min = -log(min_exp);
+	}
+
+	//maximum |y1 + y2|/2 at which x1 <= 1 and x2 <= 1 for the given |y1 - y2|
+	//negative if there is no such rapidities
+	double MaxYboost(const double xt, const double delta_y)
+	{
+		return -log(xt*cosh(delta_y/2.));
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+//counter based random numbers generator Philox4x32-10
+//(J.K. Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", SC11)
+//the output is a function of (key, counter) only so any (seed, stream, substream)
+//gives an independent sequence that does not depend on the order in which the streams are used
+namespace Philox
+{
+	inline void MulHiLo(const uint32_t a, const uint32_t b, uint32_t &hi, uint32_t &lo)
+	{
+		const uint64_t product = static_cast<uint64_t>(a)*static_cast<uint64_t>(b);
+		hi = static_cast<uint32_t>(product >> 32);
+		lo = static_cast<uint32_t>(product);
+	}
+
+	inline std::array<uint32_t, 4> Philox4x32(std::array<uint32_t, 4> ctr, std::array<uint32_t, 2> key)
+	{
+		for (int i = 0; i < 10; i++)
+		{
+			uint32_t hi0, lo0, hi1, lo1;
+			MulHiLo(0xD2511F53, ctr[0], hi0, lo0);
+			MulHiLo(0xCD9E8D57, ctr[2], hi1, lo1);
+			ctr = {hi1 ^ ctr[1] ^ key[0], lo1, hi0 ^ ctr[3] ^ key[1], lo0};
+			key[0] += 0x9E3779B9;
+			key[1] += 0xBB67AE85;
+		}
+		return ctr;
+	}
+}
+
+//sequence of random numbers for the given (seed, stream, substream)
+//e.g. stream can be the bin number and substream the block of samples in the bin
+//or stream can be the event number; every call produces the next 32 bits of the sequence
+class RandomStream
+{
+	private:
+	std::array<uint32_t, 2> key;
+	std::array<uint32_t, 4> ctr;
+	std::array<uint32_t, 4> buffer;
+	int index = 4;
+
+	uint32_t NextUInt()
+	{
+		if (index == 4)
+		{
+			buffer = Philox::Philox4x32(ctr, key);
+			ctr[0]++;
+			index = 0;
+		}
+		return buffer[index++];
+	}
+
+	public :
+
+	RandomStream(const uint64_t seed, const uint64_t stream = 0, const uint32_t substream = 0)
+	{
+		key = {static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)};
+		ctr = {0, substream, static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32)};
+	}
+
+	//uniform in [0, 1) with 53 random bits
+	double Uniform()
+	{
+		const uint64_t a = NextUInt() >> 5;
+		const uint64_t b = NextUInt() >> 6;
+		return (static_cast<double>(a)*67108864. + static_cast<double>(b))/9007199254740992.;
+	}
+
+	double Uniform(const double min, const double max) {return min + (max - min)*Uniform();}
+
+	//uniform float in [0, 1) with 24 random bits
+	float UniformFloat() {return static_cast<float>(NextUInt() >> 8)/16777216.f;}
+
+	uint32_t Integer() {return NextUInt();}
+};
+
+//time based seed used when no seed is specified
+inline unsigned int GetRandomSeed()
+{
+	auto now = std::chrono::high_resolution_clock::now();
+	auto now_ms = std::chrono::time_point_cast<std::chrono::milliseconds>(now);
+	auto epoch = now_ms.time_since_epoch();
+	auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(epoch);
+	//0 would mean no seed
+	return static_cast<unsigned int>(1 + duration.count() % 899999999);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <fstream>
+#include <chrono>
+
+#include <sys/resource.h>
+
+//wall time, peak memory, and other counters of the run written into the text file
+//as "name value" lines; used by the regression tests (src/regression.py)
+class RunStats
+{
+	private:
+	std::chrono::steady_clock::time_point start;
+	std::vector<std::pair<std::string, double>> entries;
+
+	public :
+
+	RunStats() {start = std::chrono::steady_clock::now();}
+
+	void Add(const std::string &name, const double value) {entries.emplace_back(name, value);}
+
+	//seconds since the construction
+	double GetWallTime() const
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	//peak resident memory of the process in MB
+	static double GetPeakMemory()
+	{
+		rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		return static_cast<double>(usage.ru_maxrss)/1024.;
+	}
+
+	//returns false if the file cannot be created
+	bool Write(const std::string &file_name) const
+	{
+		std::ofstream file(file_name);
+		if (!file.is_open()) return false;
+
+		file << "wall_time " << GetWallTime() << std::endl;
+		file << "peak_memory " << GetPeakMemory() << std::endl;
+		for (const std::pair<std::string, double> &entry : entries) 
+		{
+			file << entry.first << " " << entry.second << std::endl;
+		}
+		return true;
+	}
+};
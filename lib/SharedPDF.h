@@ -0,0 +1,251 @@
+#pragma once
+
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <functional>
+#include <algorithm>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+//PDF tabulated in the POSIX shared memory segment so that all processes on the node
+//use one read-only copy: the segment is created once and the processes attach to it without copying
+//xf of the flavours from -5 to 5 and alpha_s of every member are tabulated in x nodes uniform
+//in ln(1/x) + 20(1 - x) from xmin to 1 and in q2 nodes uniform in ln(q2) from q2min to q2max
+//and are interpolated by the 3rd order Lagrange polynomials in both variables; outside of the grid
+//the values are frozen at its edges as the LHAPDF sets in pythia with PDF:extrapolate = off
+namespace SharedPDF
+{
+	constexpr unsigned int nflavours = 11;
+
+	//the tag is written after the data so the segment that is still being filled is not used
+	constexpr char tag[16] = "dijetxs_pdf_v2";
+
+	struct Header
+	{
+		char tag[16];
+		//name of the tabulated set (truncated to 127 characters)
+		char pdfset_name[128];
+		uint32_t nmembers, nx, nq2;
+		double xmin, q2min, q2max;
+	};
+
+	inline double GetXVariable(const double x) {return log(1./x) + 20.*(1. - x);}
+
+	//inverse of GetXVariable; the Newton method converges monotonically from exp(-var)
+	inline double GetXFromVariable(const double var)
+	{
+		double x = exp(-var);
+		for (int i = 0; i < 100; i++)
+		{
+			const double delta = (GetXVariable(x) - var)/(1./x + 20.);
+			x += delta;
+			if (fabs(delta) < 1e-15*x) break;
+		}
+		return x;
+	}
+
+	//coefficients of the 3rd order Lagrange polynomial at the point t in units of the step
+	//between n >= 4 nodes; returns the index of the first of the 4 nodes
+	inline int GetLagrangeCoefficients(const double t, const int n, double *coefficients)
+	{
+		int first = static_cast<int>(floor(t)) - 1;
+		if (first < 0) first = 0;
+		if (first > n - 4) first = n - 4;
+
+		for (int i = 0; i < 4; i++)
+		{
+			coefficients[i] = 1.;
+			for (int j = 0; j < 4; j++)
+			{
+				if (j != i) coefficients[i] *= (t - static_cast<double>(first + j))/static_cast<double>(i - j);
+			}
+		}
+		return first;
+	}
+
+	inline unsigned long GetSize(const unsigned int nmembers, const unsigned int nx, const unsigned int nq2)
+	{
+		return sizeof(Header) + sizeof(double)*nmembers*nq2*(nx*nflavours + 1);
+	}
+
+	//read-only view of the segment; data of the member m is at [((m*nq2 + k)*nx + i)*nflavours + id + 5]
+	//and alpha_s of the member m is at [m*nq2 + k] after all xf
+	class Segment
+	{
+		private:
+		void *address = MAP_FAILED;
+		unsigned long size = 0;
+		const Header *header = nullptr;
+		const double *xf_data = nullptr;
+		const double *alphas_data = nullptr;
+		double x_var_min, x_step, log_q2min, q2_step;
+
+		public :
+
+		//the segment is not open (IsOpen() is false) if it does not exist or is not filled yet
+		Segment(const std::string &name)
+		{
+			const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+			if (fd < 0) return;
+
+			struct stat info;
+			if (fstat(fd, &info) == 0 && static_cast<unsigned long>(info.st_size) >= sizeof(Header))
+			{
+				size = info.st_size;
+				address = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+			}
+			close(fd);
+			if (address == MAP_FAILED) return;
+
+			header = static_cast<const Header *>(address);
+			if (strncmp(header->tag, tag, sizeof(tag)) != 0 ||
+				size < GetSize(header->nmembers, header->nx, header->nq2) || header->nx < 4 || header->nq2 < 4)
+			{
+				header = nullptr;
+				return;
+			}
+
+			xf_data = reinterpret_cast<const double *>(static_cast<const char *>(address) + sizeof(Header));
+			alphas_data = xf_data + static_cast<unsigned long>(header->nmembers)*header->nq2*header->nx*nflavours;
+
+			x_var_min = GetXVariable(header->xmin);
+			x_step = x_var_min/static_cast<double>(header->nx - 1);
+			log_q2min = log(header->q2min);
+			q2_step = (log(header->q2max) - log_q2min)/static_cast<double>(header->nq2 - 1);
+		}
+
+		~Segment()
+		{
+			if (address != MAP_FAILED) munmap(address, size);
+		}
+
+		Segment(const Segment &) = delete;
+		Segment &operator=(const Segment &) = delete;
+
+		bool IsOpen() const {return header != nullptr;}
+		unsigned int GetNmembers() const {return header->nmembers;}
+		std::string GetPDFSetName() const {return header->pdfset_name;}
+		unsigned int GetNx() const {return header->nx;}
+		unsigned int GetNq2() const {return header->nq2;}
+		double GetXmin() const {return header->xmin;}
+		double GetQ2min() const {return header->q2min;}
+		double GetQ2max() const {return header->q2max;}
+
+		//x and q2 moved into the grid
+		double GetClampedX(const double x) const {return std::min(std::max(x, header->xmin), 1.);}
+		double GetClampedQ2(const double q2) const {return std::min(std::max(q2, header->q2min), header->q2max);}
+
+		//xf of the flavours from -5 to 5 with index id + 5
+		void xfxQ2(const unsigned int member, const double x, const double q2, double *xf) const
+		{
+			double cx[4], cq2[4];
+			const int first_x = GetLagrangeCoefficients((x_var_min - GetXVariable(GetClampedX(x)))/x_step, 
+				header->nx, cx);
+			const int first_q2 = GetLagrangeCoefficients((log(GetClampedQ2(q2)) - log_q2min)/q2_step, 
+				header->nq2, cq2);
+
+			for (unsigned int id = 0; id < nflavours; id++) xf[id] = 0.;
+			for (int k = 0; k < 4; k++)
+			{
+				for (int i = 0; i < 4; i++)
+				{
+					const double coefficient = cq2[k]*cx[i];
+					const double *node = xf_data +
+						((static_cast<unsigned long>(member)*header->nq2 + first_q2 + k)*header->nx + first_x + i)*nflavours;
+					for (unsigned int id = 0; id < nflavours; id++) xf[id] += coefficient*node[id];
+				}
+			}
+		}
+
+		double alphasQ2(const unsigned int member, const double q2) const
+		{
+			double cq2[4];
+			const int first_q2 = GetLagrangeCoefficients((log(GetClampedQ2(q2)) - log_q2min)/q2_step, 
+				header->nq2, cq2);
+
+			double result = 0.;
+			for (int k = 0; k < 4; k++) result += cq2[k]*alphas_data[member*header->nq2 + first_q2 + k];
+			return result;
+		}
+	};
+
+	//creates the segment with the set pdfset_name and fills it with xf(member, x, q2, xf of 11 flavours) 
+	//and alphas(member, q2); returns false if the segment already exists or cannot be created
+	inline bool Create(const std::string &name, const std::string &pdfset_name, const unsigned int nmembers,
+		const unsigned int nx, const unsigned int nq2, const double xmin, const double q2min, const double q2max,
+		std::function<void(unsigned int, double, double, double *)> xf,
+		std::function<double(unsigned int, double)> alphas)
+	{
+		if (nx < 4 || nq2 < 4) return false;
+
+		const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+		if (fd < 0) return false;
+
+		const unsigned long size = GetSize(nmembers, nx, nq2);
+		void *address = MAP_FAILED;
+		if (ftruncate(fd, size) == 0) address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (address == MAP_FAILED)
+		{
+			shm_unlink(name.c_str());
+			return false;
+		}
+
+		Header *header = static_cast<Header *>(address);
+		strncpy(header->pdfset_name, pdfset_name.c_str(), sizeof(header->pdfset_name) - 1);
+		header->pdfset_name[sizeof(header->pdfset_name) - 1] = '\0';
+		header->nmembers = nmembers;
+		header->nx = nx;
+		header->nq2 = nq2;
+		header->xmin = xmin;
+		header->q2min = q2min;
+		header->q2max = q2max;
+
+		double *xf_data = reinterpret_cast<double *>(static_cast<char *>(address) + sizeof(Header));
+		double *alphas_data = xf_data + static_cast<unsigned long>(nmembers)*nq2*nx*nflavours;
+
+		for (unsigned int m = 0; m < nmembers; m++)
+		{
+			for (unsigned int k = 0; k < nq2; k++)
+			{
+				const double q2 = exp(log(q2min) + (log(q2max) - log(q2min))*k/static_cast<double>(nq2 - 1));
+				alphas_data[m*nq2 + k] = alphas(m, q2);
+
+				for (unsigned int i = 0; i < nx; i++)
+				{
+					const double x = GetXFromVariable(GetXVariable(xmin)*(1. - i/static_cast<double>(nx - 1)));
+					xf(m, x, q2, xf_data + ((static_cast<unsigned long>(m)*nq2 + k)*nx + i)*nflavours);
+				}
+			}
+		}
+
+		memcpy(header->tag, tag, sizeof(tag));
+		munmap(address, size);
+		return true;
+	}
+
+	inline bool Remove(const std::string &name) {return shm_unlink(name.c_str()) == 0;}
+
+	//PDF sets in the segments are named shm:/<segment name> or shm:/<segment name>/<member>
+	//(the segments of DijetXS::SharePDF are /dijetxs_<set> so the names are shm:/dijetxs_<set>[/<member>]);
+	//returns false if the name is not of this form
+	inline bool ParseName(const std::string &pdfset_name, std::string &segment_name, unsigned int &member)
+	{
+		if (pdfset_name.compare(0, 5, "shm:/") != 0) return false;
+
+		segment_name = pdfset_name.substr(4);
+		member = 0;
+		const unsigned long slash = segment_name.find('/', 1);
+		if (slash != std::string::npos)
+		{
+			member = std::stoul(segment_name.substr(slash + 1));
+			segment_name = segment_name.substr(0, slash);
+		}
+		return true;
+	}
+}
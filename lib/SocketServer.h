@@ -0,0 +1,140 @@
+#pragma once
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <set>
+#include <mutex>
+#include <chrono>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "ErrorHandler.h"
+#include "OutputTool.h"
+
+//line based server on the local unix socket
+//every connection is served in its own thread: every received line is passed to the handler
+//and the returned string is sent back followed by the new line
+//the line "quit" closes the connection and the line "shutdown" stops the server
+class SocketServer
+{
+	private:
+	std::string path;
+	int server_fd = -1;
+	std::atomic<bool> is_running;
+
+	//sockets of the connections that are served
+	std::set<int> connections;
+	std::mutex connections_mutex;
+
+	void CloseConnection(const int fd)
+	{
+		std::lock_guard<std::mutex> lock(connections_mutex);
+		connections.erase(fd);
+		close(fd);
+	}
+
+	void Serve(const int fd, std::function<std::string(const std::string &)> handler)
+	{
+		std::string buffer;
+		char chunk[4096];
+
+		while (is_running)
+		{
+			const ssize_t size = read(fd, chunk, sizeof(chunk));
+			if (size <= 0) break;
+			buffer.append(chunk, size);
+
+			unsigned long end;
+			while ((end = buffer.find('\n')) != std::string::npos)
+			{
+				const std::string line = buffer.substr(0, end);
+				buffer.erase(0, end + 1);
+
+				if (line == "quit")
+				{
+					CloseConnection(fd);
+					return;
+				}
+				if (line == "shutdown")
+				{
+					Stop();
+					break;
+				}
+
+				//MSG_NOSIGNAL: the client that disconnects before the response must not kill the server by SIGPIPE
+				const std::string response = handler(line) + "\n";
+				if (send(fd, response.c_str(), response.size(), MSG_NOSIGNAL) < 0) break;
+			}
+		}
+		CloseConnection(fd);
+	}
+
+	public :
+
+	SocketServer(std::string socket_path)
+	{
+		path = socket_path;
+		is_running = false;
+	}
+
+	~SocketServer() {Stop();}
+
+	//blocks until the server is stopped
+	void Run(std::function<std::string(const std::string &)> handler)
+	{
+		server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (server_fd < 0) PrintError("Socket cannot be created");
+
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+		if (path.size() >= sizeof(address.sun_path)) PrintError("Socket path " + path + " is too long");
+		path.copy(address.sun_path, path.size());
+
+		unlink(path.c_str());
+		if (bind(server_fd, (sockaddr *) &address, sizeof(address)) < 0)
+		{
+			PrintError("Socket " + path + " cannot be bound");
+		}
+		if (listen(server_fd, 64) < 0) PrintError("Socket " + path + " cannot be listened");
+
+		is_running = true;
+		PrintInfo("Listening on " + path);
+
+		while (is_running)
+		{
+			const int fd = accept(server_fd, nullptr, nullptr);
+			if (fd < 0) continue;
+			{
+				std::lock_guard<std::mutex> lock(connections_mutex);
+				connections.insert(fd);
+			}
+			std::thread(&SocketServer::Serve, this, fd, handler).detach();
+		}
+
+		//waiting for the connections that are still served
+		while (true)
+		{
+			{
+				std::lock_guard<std::mutex> lock(connections_mutex);
+				if (connections.empty()) break;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		unlink(path.c_str());
+	}
+
+	void Stop()
+	{
+		if (!is_running.exchange(false)) return;
+		shutdown(server_fd, SHUT_RDWR);
+		close(server_fd);
+
+		//unblocks the connections waiting for the requests
+		std::lock_guard<std::mutex> lock(connections_mutex);
+		for (const int fd : connections) shutdown(fd, SHUT_RDWR);
+	}
+};
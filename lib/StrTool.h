@@ -2,6 +2,7 @@
 #include <string>
 #include <sstream>
 #include <iomanip>
+#include <cstdint>
 
 std::string FtoStr(float val, const int precision = 2)
 {
@@ -22,3 +23,15 @@ std::string BtoStr(bool val)
 	if (val) return "true";
 	return "false";
 }
+
+//64-bit FNV-1a hash; unlike std::hash it is the same for every compiler and run
+uint64_t HashStr(const std::string &str)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (const char c : str)
+	{
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
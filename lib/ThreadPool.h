@@ -0,0 +1,105 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <memory>
+
+//calls func(i) for i in [0, n) in nthreads threads; tasks are taken one by one
+//so the order in which they are processed is not defined and every task must be independent
+//progress(fraction of finished tasks) is called only from the calling thread
+inline void ParallelFor(const unsigned long n, unsigned int nthreads,
+	std::function<void(unsigned long)> func,
+	std::function<void(double)> progress = [](double) {})
+{
+	if (nthreads == 0) nthreads = std::thread::hardware_concurrency();
+	if (nthreads == 0) nthreads = 1;
+
+	std::atomic<unsigned long> next_task(0);
+	std::atomic<unsigned long> nfinished(0);
+
+	auto work = [&](const bool is_main)
+	{
+		for (unsigned long i = next_task++; i < n; i = next_task++)
+		{
+			func(i);
+			nfinished++;
+			if (is_main) progress(static_cast<double>(nfinished)/static_cast<double>(n));
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < nthreads; i++) threads.emplace_back(work, false);
+	work(true);
+	for (std::thread &thread : threads) thread.join();
+	progress(1.);
+}
+
+//fixed number of threads that execute the submitted tasks in the order of submission
+//threads live as long as the pool so the thread_local data (e.g. PDFs) stays loaded between tasks
+class ThreadPool
+{
+	private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable tasks_cv;
+	bool is_stopped = false;
+
+	void Work()
+	{
+		while (true)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				tasks_cv.wait(lock, [this] {return is_stopped || !tasks.empty();});
+				if (tasks.empty()) return;
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+			task();
+		}
+	}
+
+	public :
+
+	//0 means the number of hardware threads
+	ThreadPool(unsigned int nthreads = 0)
+	{
+		if (nthreads == 0) nthreads = std::thread::hardware_concurrency();
+		if (nthreads == 0) nthreads = 1;
+		for (unsigned int i = 0; i < nthreads; i++) workers.emplace_back(&ThreadPool::Work, this);
+	}
+
+	//finishes all submitted tasks before the threads are joined
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			is_stopped = true;
+		}
+		tasks_cv.notify_all();
+		for (std::thread &worker : workers) worker.join();
+	}
+
+	template <typename F>
+	auto Submit(F func) -> std::future<decltype(func())>
+	{
+		auto task = std::make_shared<std::packaged_task<decltype(func())()>>(func);
+		std::future<decltype(func())> result = task->get_future();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			tasks.emplace_back([task] {(*task)();});
+		}
+		tasks_cv.notify_one();
+		return result;
+	}
+
+	unsigned int GetNthreads() const {return workers.size();}
+};
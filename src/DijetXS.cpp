@@ -0,0 +1,1283 @@
+#include <cmath>
+#include <array>
+#include <utility>
+#include <vector>
+#include <map>
+#include <memory>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <exception>
+#include <future>
+#include <algorithm>
+
+#include "LHAPDF/LHAPDF.h"
+
+#include "../lib/Tool.h"
+#include "../lib/ThreadPool.h"
+#include "../lib/PhaseSpaceMap.h"
+#include "../lib/SharedPDF.h"
+#include "../lib/CutSets.h"
+
+#include "DijetXS.h"
+
+using namespace LHAPDF;
+using namespace Tool;
+
+namespace DijetXS
+{
+	void MCSum::Add(const double estimate)
+	{
+		sum += estimate;
+		sum2 += estimate*estimate;
+	}
+
+	void MCSum::Add(const MCSum &block)
+	{
+		sum += block.sum;
+		sum2 += block.sum2;
+		n += block.n;
+	}
+
+	MCResult MCSum::GetResult() const
+	{
+		MCResult result;
+		if (n < 1.) return result;
+		result.value = sum/n;
+		result.error = sqrt(Maximum(sum2/n - result.value*result.value, 0.)/n);
+		return result;
+	}
+
+	void PrecisionStat::Add(const PrecisionStat &stat)
+	{
+		max_deviation = Maximum(max_deviation, stat.max_deviation);
+		sum_deviation2 += stat.sum_deviation2;
+		sum_double += stat.sum_double;
+		sum_float += stat.sum_float;
+		n += stat.n;
+	}
+
+	uint64_t GetStreamId(const Observable observable, const int bin)
+	{
+		return (static_cast<uint64_t>(observable) << 32) | static_cast<uint64_t>(bin);
+	}
+
+	//xf and alpha_s of the LHAPDF member
+	class LHAPDFSource : public PDFSource
+	{
+		private:
+		std::unique_ptr<const PDF> pdf;
+
+		public :
+
+		LHAPDFSource(const std::string &pdfset_name) : pdf(mkPDF(pdfset_name)) {}
+
+		void xfxQ2(const double x, const double q2, std::vector<double> &xf) const override
+		{
+			pdf->xfxQ2(x, q2, xf);
+		}
+
+		double alphasQ2(const double q2) const override {return pdf->alphasQ2(q2);}
+	};
+
+	//xf and alpha_s of the member of the PDF set in the shared memory segment
+	class SharedPDFSource : public PDFSource
+	{
+		private:
+		std::shared_ptr<const SharedPDF::Segment> segment;
+		unsigned int member;
+
+		public :
+
+		SharedPDFSource(std::shared_ptr<const SharedPDF::Segment> pdf_segment, const unsigned int pdf_member)
+		{
+			segment = pdf_segment;
+			member = pdf_member;
+		}
+
+		void xfxQ2(const double x, const double q2, std::vector<double> &xf) const override
+		{
+			//top quarks are not tabulated
+			xf.assign(13, 0.);
+			segment->xfxQ2(member, x, q2, &xf[1]);
+		}
+
+		double alphasQ2(const double q2) const override {return segment->alphasQ2(member, q2);}
+	};
+
+	//the segment is mapped once per process and is used by all threads
+	std::shared_ptr<const SharedPDF::Segment> GetSegment(const std::string &segment_name)
+	{
+		static std::map<std::string, std::shared_ptr<const SharedPDF::Segment>> segments;
+		static std::mutex segments_mutex;
+
+		std::lock_guard<std::mutex> lock(segments_mutex);
+		std::shared_ptr<const SharedPDF::Segment> &segment = segments[segment_name];
+		if (!segment) segment = std::make_shared<const SharedPDF::Segment>(segment_name);
+		return segment;
+	}
+
+	//LHAPDF grids are not guaranteed to be thread safe so every thread uses its own copy
+	//of every set it was asked for; the sets in the shared memory are mapped only once
+	const PDFSource *GetPDF(const std::string &pdfset_name)
+	{
+		thread_local std::map<std::string, std::unique_ptr<const PDFSource>> pdfs;
+		std::unique_ptr<const PDFSource> &pdf = pdfs[pdfset_name];
+		if (pdf) return pdf.get();
+
+		std::string segment_name;
+		unsigned int member;
+		if (SharedPDF::ParseName(pdfset_name, segment_name, member))
+		{
+			std::shared_ptr<const SharedPDF::Segment> segment = GetSegment(segment_name);
+			if (!segment->IsOpen())
+			{
+				throw std::runtime_error("Shared PDF segment " + segment_name + " is not available");
+			}
+			if (member >= segment->GetNmembers())
+			{
+				throw std::runtime_error("Shared PDF segment " + segment_name + " has no member " + 
+					std::to_string(member));
+			}
+			pdf.reset(new SharedPDFSource(segment, member));
+		}
+		else pdf.reset(new LHAPDFSource(pdfset_name));
+		return pdf.get();
+	}
+
+	std::string GetSharedPDFName(const std::string &pdfset_name)
+	{
+		return "/dijetxs_" + pdfset_name;
+	}
+
+	bool SharePDF(const std::string &pdfset_name, const unsigned int nx, const unsigned int nq2)
+	{
+		const unsigned int nmembers = getPDFSet(pdfset_name).size();
+
+		//members are loaded one by one so only one of them is in memory at a time
+		std::unique_ptr<PDF> pdf(mkPDF(pdfset_name, 0));
+		unsigned int pdf_member = 0;
+		auto get_member = [&](const unsigned int member)
+		{
+			if (member != pdf_member) 
+			{
+				pdf.reset(mkPDF(pdfset_name, member));
+				pdf_member = member;
+			}
+			return pdf.get();
+		};
+
+		std::vector<double> xf_all;
+		return SharedPDF::Create(GetSharedPDFName(pdfset_name), pdfset_name, nmembers, nx, nq2, 
+			pdf->xMin(), pdf->q2Min(), pdf->q2Max(),
+			[&](const unsigned int member, const double x, const double q2, double *xf)
+		{
+			get_member(member)->xfxQ2(x, q2, xf_all);
+			for (unsigned int id = 0; id < SharedPDF::nflavours; id++) xf[id] = xf_all[id + 1];
+		}, [&](const unsigned int member, const double q2)
+		{
+			return get_member(member)->alphasQ2(q2);
+		});
+	}
+
+	bool UnsharePDF(const std::string &pdfset_name)
+	{
+		return SharedPDF::Remove(GetSharedPDFName(pdfset_name));
+	}
+
+	double CheckSharedPDF(const std::string &pdfset_name, const unsigned int member)
+	{
+		//GetPDF throws if the segment or the member is not available
+		const PDFSource *shared_pdf = GetPDF("shm:" + GetSharedPDFName(pdfset_name) + "/" + std::to_string(member));
+		const SharedPDF::Segment &segment = *GetSegment(GetSharedPDFName(pdfset_name));
+		std::unique_ptr<const PDF> pdf(mkPDF(pdfset_name, member));
+
+		const double xmin = segment.GetXmin(), q2min = segment.GetQ2min(), q2max = segment.GetQ2max();
+
+		//points between the nodes inside the grid, the edges, and the points outside of the grid
+		std::vector<double> x_points = {xmin, 1., 0.1*xmin, 1e-3*xmin};
+		std::vector<double> q2_points = {q2min, q2max, 0.5*q2min, 2.*q2max};
+		const unsigned int npoints = 37;
+		for (unsigned int i = 0; i < npoints; i++)
+		{
+			const double t = (i + 0.5)/static_cast<double>(npoints);
+			x_points.push_back(SharedPDF::GetXFromVariable(SharedPDF::GetXVariable(xmin)*(1. - t)));
+			q2_points.push_back(exp(log(q2min) + (log(q2max) - log(q2min))*t));
+		}
+
+		double max_deviation = 0.;
+		std::vector<double> xf, shared_xf;
+		for (const double q2 : q2_points)
+		{
+			const double alphas = pdf->alphasQ2(segment.GetClampedQ2(q2));
+			max_deviation = Maximum(max_deviation, fabs(shared_pdf->alphasQ2(q2) - alphas)/alphas);
+
+			for (const double x : x_points)
+			{
+				pdf->xfxQ2(segment.GetClampedX(x), segment.GetClampedQ2(q2), xf);
+				shared_pdf->xfxQ2(x, q2, shared_xf);
+
+				//top quarks are not tabulated
+				double max_xf = 0.;
+				for (unsigned int id = 1; id < 12; id++) max_xf = Maximum(max_xf, fabs(xf[id]));
+				if (max_xf <= 0.) continue;
+				for (unsigned int id = 1; id < 12; id++)
+				{
+					max_deviation = Maximum(max_deviation, fabs(shared_xf[id] - xf[id])/max_xf);
+				}
+			}
+		}
+		return max_deviation;
+	}
+
+	//cross sections dsigma/dOmega for different processes
+	//T is double or float for the low precision integrand
+	//qq'->qq'
+	template <typename T>
+	T CS_QQp_QQp(const T s, const T t, const T u)
+	{
+		return T(1.)/(T(9.)*s)*(s*s + u*u)/(t*t);
+	}
+
+	//qq->qq
+	template <typename T>
+	T CS_QQ_QQ(const T s, const T t, const T u)
+	{
+		return T(1.)/(T(9.)*s)*((t*t + s*s)/(u*u) + (s*s + u*u)/(t*t) - T(2.)*s*s/(T(3.)*u*t));
+	}
+
+	//qqbar->q'qbar'
+	template <typename T>
+	T CS_QQbar_QpQbarp(const T s, const T t, const T u)
+	{
+		return T(1.)/(T(9.)*s)*(t*t + u*u)/(s*s);
+	}
+
+	//qqbar->qqbar
+	template <typename T>
+	T CS_QQbar_QQbar(const T s, const T t, const T u)
+	{
+		return T(1.)/(T(9.)*s)*((t*t + u*u)/(s*s) + (s*s + u*u)/(t*t) - T(2.)*u*u/(T(3.)*s*t));
+	}
+
+	//qqbar->gg
+	template <typename T>
+	T CS_QQbar_GG(const T s, const T t, const T u)
+	{
+		return T(8.)/(T(27.)*s)*(t*t + u*u)*(T(1.)/(t*u) - T(9.)/(T(4.)*s*s));
+	}
+
+	//gg->qqbar
+	template <typename T>
+	T CS_GG_QQbar(const T s, const T t, const T u)
+	{
+		return T(1.)/(T(24.)*s)*(t*t + u*u)*(T(1.)/(t*u) - T(9.)/(T(4.)*s*s));
+	}
+
+	//gq->gq
+	template <typename T>
+	T CS_GQ_GQ(const T s, const T t, const T u)
+	{
+		return T(1.)/(T(9.)*s)*(s*s + u*u)*(T(-1.)/(s*u) + T(9.)/(T(4.)*t*t));
+	}
+
+	//gg->gg
+	template <typename T>
+	T CS_GG_GG(const T s, const T t, const T u)
+	{
+		return T(9.)/(T(8.)*s)*(T(3.) - (u*t)/(s*s) - (s*u)/(t*t) - (s*t)/(u*u));
+	}
+
+	//variables shortcuts
+	template <typename T> T CosTheta(const T s, const T pt) {return sqrt(T(1.)-(T(4.)*pt*pt/s));}
+	template <typename T> T MandelstamT(const T s, const T cos_theta) {return -s/T(2.)*(T(1.)-cos_theta);}
+	template <typename T> T MandelstamU(const T s, const T cos_theta) {return -s/T(2.)*(T(1.)+cos_theta);}
+
+	//channels of the processes by the flavours of the incoming partons
+	enum Channel {kGG, kGQ, kQQ, kQQbar, kQQp, kNChannels};
+
+	//flavours are from -5 to 5 and 0 is gluon
+	constexpr Channel GetChannel(const int id1, const int id2)
+	{
+		if (id1 == 0 && id2 == 0) return kGG;
+		if (id2 == 0 || id1 == 0) return kGQ;
+		if (id1 == id2) return kQQ;
+		if (id1 == -id2) return kQQbar;
+		return kQQp;
+	}
+
+	constexpr int nflavours = 11;
+
+	constexpr std::array<std::array<Channel, nflavours>, nflavours> MakeChannelTable()
+	{
+		std::array<std::array<Channel, nflavours>, nflavours> table{};
+		for (int i = 0; i < nflavours; i++)
+		{
+			for (int j = 0; j < nflavours; j++) table[i][j] = GetChannel(i - 5, j - 5);
+		}
+		return table;
+	}
+
+	//channel of every pair of flavours with index [id1 + 5][id2 + 5]
+	constexpr std::array<std::array<Channel, nflavours>, nflavours> channel_table = MakeChannelTable();
+
+	//returns dsigma/dOmega of the channel without alpha_s^2
+	template <Channel channel, typename T>
+	T CS_Channel(const T s, const T t, const T u)
+	{
+		if constexpr (channel == kGG) return CS_GG_GG(s, t, u) + CS_GG_QQbar(s, t, u);
+		else if constexpr (channel == kGQ) return CS_GQ_GQ(s, t, u);
+		else if constexpr (channel == kQQ) return CS_QQ_QQ(s, t, u);
+		else if constexpr (channel == kQQbar) 
+		{
+			return CS_QQbar_QQbar(s, t, u) + CS_QQbar_GG(s, t, u) + CS_QQbar_QpQbarp(s, t, u);
+		}
+		else return CS_QQp_QQp(s, t, u);
+	}
+
+	//sum of xf1*xf2*cs over all 121 pairs of flavours; the channel of every term 
+	//is known at compile time so the sum is unrolled without the lookups in the table
+	template <typename T, std::size_t... I>
+	T SumOverFlavours(const T *xf1, const T *xf2, const T *cs, std::index_sequence<I...>)
+	{
+		return (T(0.) + ... + (xf1[I/nflavours]*xf2[I%nflavours]*cs[channel_table[I/nflavours][I%nflavours]]));
+	}
+
+	double X1(const double pt, const double sqrt_s, const double y1, const double y2)
+	{
+		return 2.*pt/sqrt_s*exp((y1+y2)/2.)*cosh((y1-y2)/2.);
+	}
+
+	double X2(const double pt, const double sqrt_s, const double y1, const double y2)
+	{
+		return 2.*pt/sqrt_s*exp(-(y1+y2)/2.)*cosh((y1-y2)/2.);
+	}
+
+	static_assert(kNChannels == nchannels, "Number of channels in DijetXS.h is wrong");
+
+	//dsigma/dOmega of all channels without alpha_s^2 computed with the precision T
+	template <typename T>
+	void GetChannelCS(const double pt, const double s, const double y1, const double y2, T *cs)
+	{
+		T cos_theta = CosTheta<T>(s, pt);
+		if (y1 - y2 < 0) cos_theta *= T(-1.);
+		
+		const T t = MandelstamT<T>(s, cos_theta);
+		const T u = MandelstamU<T>(s, cos_theta);
+
+		cs[kGG] = CS_Channel<kGG, T>(s, t, u);
+		cs[kGQ] = CS_Channel<kGQ, T>(s, t, u);
+		cs[kQQ] = CS_Channel<kQQ, T>(s, t, u);
+		cs[kQQbar] = CS_Channel<kQQbar, T>(s, t, u);
+		cs[kQQp] = CS_Channel<kQQp, T>(s, t, u);
+	}
+
+	//factor that converts the sum over channels of dsigma/dOmega times PDFs into dsigma/dpTdy1dy2
+	//without alpha_s^2; 1e9 is to get pb instead of mb
+	double GetNormalization(const double pt, const double s)
+	{
+		return 8.*M_PI*1e9*pt/s;
+	}
+
+	//dsigma/dpTdy1dy2 computed with the precision T
+	template <typename T>
+	T DsigmaDpTDy1Dy2(const PDFSource *pdf, const double pt, const double s, 
+		const double y1, const double y2, const double x1, const double x2)
+	{
+		//xf for all flavours from -6 to 6 with index id + 6
+		thread_local std::vector<double> xf1_all, xf2_all;
+		pdf->xfxQ2(x1, pt*pt, xf1_all);
+		pdf->xfxQ2(x2, pt*pt, xf2_all);
+
+		T xf1[nflavours], xf2[nflavours];
+		for (int i = 0; i < nflavours; i++)
+		{
+			xf1[i] = static_cast<T>(xf1_all[i + 1]);
+			xf2[i] = static_cast<T>(xf2_all[i + 1]);
+		}
+
+		const T alpha_s = static_cast<T>(pdf->alphasQ2(pt*pt));
+
+		T cs[kNChannels];
+		GetChannelCS<T>(pt, s, y1, y2, cs);
+
+		//summation over pairs of flavours
+		const T result = SumOverFlavours<T>(xf1, xf2, cs, std::make_index_sequence<nflavours*nflavours>());
+
+		return static_cast<T>(GetNormalization(pt, s))*result*alpha_s*alpha_s;
+	}
+
+	//statistics of the current thread; taken by TakePrecisionStat
+	thread_local PrecisionStat thread_precision_stat;
+
+	PrecisionStat TakePrecisionStat()
+	{
+		const PrecisionStat stat = thread_precision_stat;
+		thread_precision_stat = PrecisionStat();
+		return stat;
+	}
+
+	//integrand calls of the current thread; taken by TakeIntegrandCalls
+	thread_local unsigned long thread_ncalls = 0;
+
+	unsigned long TakeIntegrandCalls()
+	{
+		const unsigned long ncalls = thread_ncalls;
+		thread_ncalls = 0;
+		return ncalls;
+	}
+
+	//integrand with the precision from config.precision
+	double Integrand(const Config &config, const double pt, const double s, 
+		const double y1, const double y2, const double x1, const double x2)
+	{
+		thread_ncalls++;
+		const PDFSource *pdf = GetPDF(config.pdfset_name);
+		if (config.precision == kFloat) return DsigmaDpTDy1Dy2<float>(pdf, pt, s, y1, y2, x1, x2);
+
+		const double result = DsigmaDpTDy1Dy2<double>(pdf, pt, s, y1, y2, x1, x2);
+		if (config.precision == kValidate && result > 0.)
+		{
+			const double result_float = DsigmaDpTDy1Dy2<float>(pdf, pt, s, y1, y2, x1, x2);
+			const double deviation = fabs(result_float/result - 1.);
+			
+			PrecisionStat &stat = thread_precision_stat;
+			stat.max_deviation = Maximum(stat.max_deviation, deviation);
+			stat.sum_deviation2 += deviation*deviation;
+			stat.sum_double += result;
+			stat.sum_float += result_float;
+			stat.n += 1.;
+		}
+		return result;
+	}
+
+	double DsigmaDpTDy1Dy2(const Config &config, const double pt, const double y1, const double y2)
+	{
+		const double x1 = X1(pt, config.energy, y1, y2);
+		const double x2 = X2(pt, config.energy, y1, y2);
+		if (pt <= 0. || x1 >= 1. || x2 >= 1.) return 0.;
+		return Integrand(config, pt, config.energy*config.energy*x1*x2, y1, y2, x1, x2);
+	}
+
+	//dsigma/dpT
+	//y1 is sampled in [0, min(|ymax|, max kinematic |y|)] and y2 is sampled only in the range
+	//where x1 < 1 and x2 < 1 for the given y1 so there are no rejected tries
+	//estimate(pt, y1, y2, x1, x2, jacobian) returns the integrand times the jacobian
+	//and end_try() is called after every try with the estimates
+	template <typename F, typename G>
+	MCSum SampleDsigmaDpT(const Config &config, const double pt, 
+		const Cuts &cuts, const double ntries, RandomStream &rand, F estimate, G end_try)
+	{	
+		MCSum result;
+		result.n = ntries;
+
+		const double xt = 2.*pt/config.energy;
+		if (xt >= 1.) return result;
+
+		const UniformMap y1_map = UniformMap(0., Minimum(cuts.abs_max_y, DijetKinematics::MaxRapidity(xt)));
+		if (y1_map.IsEmpty()) return result;
+
+		for (double i = 0; i < ntries; i++)
+		{
+			(void)i;
+			
+			double y1_jacobian, y2_jacobian;
+			const double y1 = y1_map.Map(rand.Uniform(), y1_jacobian);
+			
+			double y2min, y2max;
+			DijetKinematics::Y2Range(xt, y1, y2min, y2max);
+			
+			const UniformMap y2_map = UniformMap(Maximum(y2min, -cuts.abs_max_y), Minimum(y2max, cuts.abs_max_y));
+			if (y2_map.IsEmpty()) continue;
+			const double y2 = y2_map.Map(rand.Uniform(), y2_jacobian);
+			
+			const double x1 = X1(pt, config.energy, y1, y2);
+			const double x2 = X2(pt, config.energy, y1, y2);
+			
+			//protection from the rounding at the edges of the range
+			if (x1 >= 1. || x2 >= 1.) continue;
+			
+			result.Add(estimate(pt, y1, y2, x1, x2, y1_jacobian*y2_jacobian));
+			end_try();
+		}
+		return result;
+	}
+
+	//dsigma/d dDeltay
+	//pT is sampled as pT^(-pt_map_power) and for both y2 = y1 -+ Deltay y1 is sampled 
+	//only in the range where |y2| < |ymax|, x1 < 1, and x2 < 1 so there are no rejected tries
+	//the integral over y1 is averaged over [0, |ymax|]
+	template <typename F, typename G>
+	MCSum SampleDsigmaDdy(const Config &config, const double delta_y, 
+		const Cuts &cuts, const double ntries, RandomStream &rand, F estimate, G end_try)
+	{	
+		MCSum result;
+		result.n = ntries;
+
+		const double ptmax = config.energy/(2.*cosh(delta_y/2.));
+		if (ptmax <= cuts.ptmin) return result;
+
+		const PowerLawMap pt_map = PowerLawMap(cuts.ptmin, ptmax, config.pt_map_power);
+
+		for (double i = 0; i < ntries; i++)
+		{
+			(void)i;
+			
+			double pt_jacobian;
+			const double pt = pt_map.Map(rand.Uniform(), pt_jacobian);
+			
+			//maximum |y1 + y2|/2
+			const double max_yboost = DijetKinematics::MaxYboost(2.*pt/config.energy, delta_y);
+			
+			//ranges of y1 for y2 = y1 - Deltay and y2 = y1 + Deltay
+			const UniformMap y1_maps[2] = 
+			{
+				UniformMap(Maximum(0., delta_y - cuts.abs_max_y, delta_y/2. - max_yboost), 
+					Minimum(cuts.abs_max_y, delta_y/2. + max_yboost)),
+				UniformMap(Maximum(0., -delta_y/2. - max_yboost), 
+					Minimum(cuts.abs_max_y - delta_y, -delta_y/2. + max_yboost))
+			};
+			
+			//both branches are one try
+			double value = 0.;
+			for (int j = 0; j < 2; j++)
+			{
+				if (y1_maps[j].IsEmpty()) continue;
+				
+				double y1_jacobian;
+				const double y1 = y1_maps[j].Map(rand.Uniform(), y1_jacobian);
+				const double y2 = (j == 0) ? y1 - delta_y : y1 + delta_y;
+				
+				const double x1 = X1(pt, config.energy, y1, y2);
+				const double x2 = X2(pt, config.energy, y1, y2);
+				
+				//protection from the rounding at the edges of the range
+				if (x1 >= 1. || x2 >= 1.) continue;
+				
+				value += estimate(pt, y1, y2, x1, x2, pt_jacobian*y1_jacobian/cuts.abs_max_y);
+			}
+			result.Add(value);
+			end_try();
+		}
+		return result;
+	}
+
+	template <typename F, typename G>
+	MCSum SampleDsigma(const Config &config, const Observable observable, const double x,
+		const Cuts &cuts, const double ntries, RandomStream &rand, F estimate, G end_try)
+	{
+		if (observable == kDsigmaDpT) return SampleDsigmaDpT(config, x, cuts, ntries, rand, estimate, end_try);
+		return SampleDsigmaDdy(config, x, cuts, ntries, rand, estimate, end_try);
+	}
+
+	template <typename F>
+	MCSum SampleDsigma(const Config &config, const Observable observable, const double x,
+		const Cuts &cuts, const double ntries, RandomStream &rand, F estimate)
+	{
+		return SampleDsigma(config, observable, x, cuts, ntries, rand, estimate, [] {});
+	}
+
+	MCSum GetDsigma(const Config &config, const Observable observable, const double x,
+		const Cuts &cuts, const double ntries, RandomStream &rand)
+	{
+		const double s = config.energy*config.energy;
+		return SampleDsigma(config, observable, x, cuts, ntries, rand, 
+			[&](const double pt, const double y1, const double y2, 
+				const double x1, const double x2, const double jacobian)
+		{
+			return Integrand(config, pt, s*x1*x2, y1, y2, x1, x2)*jacobian;
+		});
+	}
+
+	std::vector<MCSum> GetDsigma(const Config &config, const Observable observable, const double x,
+		const std::vector<Cuts> &cut_sets, const double ntries, RandomStream &rand)
+	{
+		const unsigned long nsets = cut_sets.size();
+		std::vector<MCSum> results(nsets);
+		if (nsets == 0) return results;
+
+		//ptmin is used only in dsigma/dDeltay
+		CutSets cuts;
+		for (const Cuts &cut_set : cut_sets) 
+		{
+			if (!cuts.Add((observable == kDsigmaDdy) ? cut_set.ptmin : 0., cut_set.abs_max_y))
+			{
+				throw std::invalid_argument("Too many cut sets");
+			}
+		}
+		const Cuts widest = {cuts.GetMinPtmin(), cuts.GetMaxAbsMaxY()};
+		cuts.SetWidestAcceptance();
+
+		//dsigma/dDeltay is averaged over [0, |ymax|] of the widest acceptance in the sampling
+		std::vector<double> scale(nsets, 1.), try_value(nsets, 0.);
+		if (observable == kDsigmaDdy)
+		{
+			for (unsigned long c = 0; c < nsets; c++) scale[c] = widest.abs_max_y/cut_sets[c].abs_max_y;
+		}
+
+		const double s = config.energy*config.energy;
+		SampleDsigma(config, observable, x, widest, ntries, rand, 
+			[&](const double pt, const double y1, const double y2, 
+				const double x1, const double x2, const double jacobian)
+		{
+			const uint64_t mask = cuts.GetPtMask(pt) & cuts.GetYMask(y1) & cuts.GetYMask(y2);
+			if (mask == 0) return 0.;
+
+			const double value = Integrand(config, pt, s*x1*x2, y1, y2, x1, x2)*jacobian;
+			for (unsigned long c = 0; c < nsets; c++) 
+			{
+				try_value[c] += static_cast<double>((mask >> c) & 1)*value*scale[c];
+			}
+			return value;
+		}, [&]
+		{
+			for (unsigned long c = 0; c < nsets; c++)
+			{
+				results[c].Add(try_value[c]);
+				try_value[c] = 0.;
+			}
+		});
+
+		for (MCSum &result : results) result.n = ntries;
+		return results;
+	}
+
+	MCResult GetDsigmaPrecise(const Config &config, const Observable observable, const double x,
+		const Cuts &cuts, const double precision, const unsigned int max_blocks,
+		const double ntries, const uint64_t seed, const uint64_t stream)
+	{
+		MCSum sum;
+		MCResult result;
+		for (uint32_t block = 0; block < max_blocks; block++)
+		{
+			RandomStream rand(seed, stream, block);
+			sum.Add(GetDsigma(config, observable, x, cuts, ntries, rand));
+			result = sum.GetResult();
+			if (result.value <= 0. || result.error < precision*result.value) break;
+		}
+		return result;
+	}
+
+	//variable in which the x nodes are uniform; dense at large x where xf changes quickly
+	double GetXVariable(const double x)
+	{
+		return log(1./x) + 5.*(1. - x);
+	}
+
+	//inverse of GetXVariable; the Newton method converges monotonically from exp(-var)
+	double GetXFromVariable(const double var)
+	{
+		double x = exp(-var);
+		for (int i = 0; i < 100; i++)
+		{
+			const double delta = (GetXVariable(x) - var)/(1./x + 5.);
+			x += delta;
+			if (fabs(delta) < 1e-15*x) break;
+		}
+		return x;
+	}
+
+	//Lagrange coefficients of the point t (in units of the step between n nodes) 
+	//of the 3rd order polynomial or of the order n - 1 if there are less than 4 nodes
+	//returns the index of the first node of the polynomial
+	int GetLagrangeCoefficients(const double t, const int n, double *coefficients, int &order)
+	{
+		order = (n > 3) ? 3 : n - 1;
+		if (order == 0)
+		{
+			coefficients[0] = 1.;
+			return 0;
+		}
+
+		int first = static_cast<int>(floor(t)) - (order - 1)/2;
+		if (first < 0) first = 0;
+		if (first > n - 1 - order) first = n - 1 - order;
+
+		for (int i = 0; i <= order; i++)
+		{
+			coefficients[i] = 1.;
+			for (int j = 0; j <= order; j++)
+			{
+				if (j != i) coefficients[i] *= (t - static_cast<double>(first + j))/static_cast<double>(i - j);
+			}
+		}
+		return first;
+	}
+
+	InterpolationGrid::InterpolationGrid(const Observable grid_observable, const double grid_x, 
+		const double xmin, const double q2min, const double q2max, 
+		const unsigned int grid_nx, const unsigned int grid_nq2)
+	{
+		observable = grid_observable;
+		x = grid_x;
+		nx = Maximum(grid_nx, 2);
+		nq2 = (q2max > q2min) ? Maximum(grid_nq2, 1) : 1;
+
+		for (unsigned int i = 0; i < nx; i++)
+		{
+			const double var = GetXVariable(xmin)*(1. - static_cast<double>(i)/static_cast<double>(nx - 1));
+			x_nodes.push_back(GetXFromVariable(var));
+		}
+		for (unsigned int k = 0; k < nq2; k++)
+		{
+			const double fraction = (nq2 > 1) ? static_cast<double>(k)/static_cast<double>(nq2 - 1) : 0.;
+			q2_nodes.push_back(exp(log(q2min) + fraction*(log(q2max) - log(q2min))));
+		}
+		weights.assign(nchannels*nx*nx*nq2, 0.);
+	}
+
+	void InterpolationGrid::Fill(const double x1, const double x2, const double q2, const double *channel_weights)
+	{
+		const double x_step = GetXVariable(x_nodes[0])/static_cast<double>(nx - 1);
+		const double q2_step = (nq2 > 1) ? (log(q2_nodes[nq2 - 1]) - log(q2_nodes[0]))/(nq2 - 1.) : 1.;
+
+		double c1[4], c2[4], cq2[4];
+		int order1, order2, order_q2;
+		const int first1 = GetLagrangeCoefficients((GetXVariable(x_nodes[0]) - GetXVariable(x1))/x_step, 
+			nx, c1, order1);
+		const int first2 = GetLagrangeCoefficients((GetXVariable(x_nodes[0]) - GetXVariable(x2))/x_step, 
+			nx, c2, order2);
+		const int first_q2 = GetLagrangeCoefficients((log(q2) - log(q2_nodes[0]))/q2_step, 
+			nq2, cq2, order_q2);
+
+		for (int a = 0; a <= order1; a++)
+		{
+			for (int b = 0; b <= order2; b++)
+			{
+				for (int k = 0; k <= order_q2; k++)
+				{
+					const double coefficient = c1[a]*c2[b]*cq2[k];
+					for (int channel = 0; channel < nchannels; channel++)
+					{
+						weights[((channel*nx + first1 + a)*nx + first2 + b)*nq2 + first_q2 + k] += 
+							coefficient*channel_weights[channel];
+					}
+				}
+			}
+		}
+	}
+
+	void InterpolationGrid::Scale(const double scale)
+	{
+		for (double &weight : weights) weight *= scale;
+	}
+
+	void InterpolationGrid::Write(std::ostream &output) const
+	{
+		const int observable_id = static_cast<int>(observable);
+		output.write((const char *) &observable_id, sizeof(observable_id));
+		output.write((const char *) &x, sizeof(x));
+		output.write((const char *) &reference, sizeof(reference));
+		output.write((const char *) &nx, sizeof(nx));
+		output.write((const char *) &nq2, sizeof(nq2));
+		output.write((const char *) x_nodes.data(), x_nodes.size()*sizeof(double));
+		output.write((const char *) q2_nodes.data(), q2_nodes.size()*sizeof(double));
+		output.write((const char *) weights.data(), weights.size()*sizeof(double));
+	}
+
+	bool InterpolationGrid::Read(std::istream &input)
+	{
+		int observable_id;
+		input.read((char *) &observable_id, sizeof(observable_id));
+		input.read((char *) &x, sizeof(x));
+		input.read((char *) &reference, sizeof(reference));
+		input.read((char *) &nx, sizeof(nx));
+		input.read((char *) &nq2, sizeof(nq2));
+		if (!input || nx < 2 || nq2 < 1) return false;
+
+		observable = static_cast<Observable>(observable_id);
+		x_nodes.resize(nx);
+		q2_nodes.resize(nq2);
+		weights.resize(nchannels*nx*nx*nq2);
+		input.read((char *) x_nodes.data(), x_nodes.size()*sizeof(double));
+		input.read((char *) q2_nodes.data(), q2_nodes.size()*sizeof(double));
+		input.read((char *) weights.data(), weights.size()*sizeof(double));
+		return static_cast<bool>(input);
+	}
+
+	MCSum FillGrid(const Config &config, const Observable observable, const double x,
+		const Cuts &cuts, const double ntries, RandomStream &rand, InterpolationGrid &grid)
+	{
+		const double s = config.energy*config.energy;
+
+		//pT range of the point: pT is fixed in dsigma/dpT
+		const double ptmin = (observable == kDsigmaDpT) ? x : cuts.ptmin;
+		const double ptmax = (observable == kDsigmaDpT) ? x : config.energy/(2.*cosh(x/2.));
+
+		//x1 = xT*exp((y1 + y2)/2)*cosh(Deltay/2) >= xT*exp(-|ymax|) and x1 >= x1*x2 >= xT^2; the same for x2
+		const double xt = 2.*ptmin/config.energy;
+		const double xmin = Minimum(Maximum(xt*exp(-cuts.abs_max_y), xt*xt), 0.99);
+
+		grid = InterpolationGrid(observable, x, xmin, ptmin*ptmin, ptmax*ptmax, config.grid_nx, config.grid_nq2);
+
+		const MCSum result = SampleDsigma(config, observable, x, cuts, ntries, rand, 
+			[&](const double pt, const double y1, const double y2, 
+				const double x1, const double x2, const double jacobian)
+		{
+			double channel_weights[nchannels];
+			GetChannelCS<double>(pt, s*x1*x2, y1, y2, channel_weights);
+			
+			const double normalization = GetNormalization(pt, s*x1*x2)*jacobian;
+			for (double &weight : channel_weights) weight *= normalization;
+			grid.Fill(x1, x2, pt*pt, channel_weights);
+
+			return Integrand(config, pt, s*x1*x2, y1, y2, x1, x2)*jacobian;
+		});
+
+		grid.Scale(1./ntries);
+		grid.reference = result.GetResult();
+		return result;
+	}
+
+	//sums of xf1*xf2 over the pairs of flavours of every channel; index of xf is id + 5
+	void GetChannelLuminosities(const double *xf1, const double *xf2, double *luminosities)
+	{
+		const int gluon = 5;
+		double quarks1 = 0., quarks2 = 0., same = 0., conjugate = 0.;
+		for (int i = 0; i < nflavours; i++)
+		{
+			if (i == gluon) continue;
+			quarks1 += xf1[i];
+			quarks2 += xf2[i];
+			same += xf1[i]*xf2[i];
+			conjugate += xf1[i]*xf2[nflavours - 1 - i];
+		}
+
+		luminosities[kGG] = xf1[gluon]*xf2[gluon];
+		luminosities[kGQ] = xf1[gluon]*quarks2 + quarks1*xf2[gluon];
+		luminosities[kQQ] = same;
+		luminosities[kQQbar] = conjugate;
+		luminosities[kQQp] = quarks1*quarks2 - same - conjugate;
+	}
+
+	MCResult Convolve(const InterpolationGrid &grid, const std::string &pdfset_name, 
+		std::function<double(double)> alphas_q2)
+	{
+		const PDFSource *pdf = GetPDF(pdfset_name);
+		const unsigned int nx = grid.GetNx();
+		const unsigned int nq2 = grid.GetNq2();
+
+		//xf of the flavours from -5 to 5 in all nodes with index [(k*nx + i)*nflavours + id + 5]
+		std::vector<double> xf(nq2*nx*nflavours);
+		std::vector<double> xf_all;
+		for (unsigned int k = 0; k < nq2; k++)
+		{
+			for (unsigned int i = 0; i < nx; i++)
+			{
+				pdf->xfxQ2(grid.GetXNode(i), grid.GetQ2Node(k), xf_all);
+				for (int id = 0; id < nflavours; id++) xf[(k*nx + i)*nflavours + id] = xf_all[id + 1];
+			}
+		}
+
+		MCResult result;
+		for (unsigned int k = 0; k < nq2; k++)
+		{
+			const double alpha_s = alphas_q2(grid.GetQ2Node(k));
+			for (unsigned int i = 0; i < nx; i++)
+			{
+				for (unsigned int j = 0; j < nx; j++)
+				{
+					double luminosities[nchannels];
+					GetChannelLuminosities(&xf[(k*nx + i)*nflavours], &xf[(k*nx + j)*nflavours], luminosities);
+					for (int channel = 0; channel < nchannels; channel++)
+					{
+						result.value += grid.GetWeight(channel, i, j, k)*alpha_s*alpha_s*luminosities[channel];
+					}
+				}
+			}
+		}
+		if (grid.reference.value > 0.) result.error = result.value*grid.reference.error/grid.reference.value;
+		return result;
+	}
+
+	MCResult Convolve(const InterpolationGrid &grid, const std::string &pdfset_name)
+	{
+		const PDFSource *pdf = GetPDF(pdfset_name);
+		return Convolve(grid, pdfset_name, [&](const double q2) {return pdf->alphasQ2(q2);});
+	}
+
+	//header of the files with the grids
+	const std::string grids_file_tag = "dijetxs_grids_v1";
+
+	bool WriteGrids(const std::string &file_name, const std::vector<InterpolationGrid> &grids)
+	{
+		std::ofstream output(file_name, std::ios::binary);
+		if (!output.is_open()) return false;
+
+		const unsigned long ngrids = grids.size();
+		output.write(grids_file_tag.c_str(), grids_file_tag.size());
+		output.write((const char *) &ngrids, sizeof(ngrids));
+		for (const InterpolationGrid &grid : grids) grid.Write(output);
+		return static_cast<bool>(output);
+	}
+
+	bool ReadGrids(const std::string &file_name, std::vector<InterpolationGrid> &grids)
+	{
+		std::ifstream input(file_name, std::ios::binary);
+		if (!input.is_open()) return false;
+
+		std::string tag(grids_file_tag.size(), ' ');
+		input.read(&tag[0], tag.size());
+		if (tag != grids_file_tag) return false;
+
+		unsigned long ngrids;
+		input.read((char *) &ngrids, sizeof(ngrids));
+		if (!input) return false;
+
+		grids.resize(ngrids);
+		for (InterpolationGrid &grid : grids) 
+		{
+			if (!grid.Read(input)) return false;
+		}
+		return true;
+	}
+
+	void GeneratorStat::Add(const GeneratorStat &stat)
+	{
+		ntries += stat.ntries;
+		naccepted += stat.naccepted;
+		nviolations += stat.nviolations;
+	}
+
+	//maxima of the cells found from a few points are increased by this factor
+	//so that the weights above the maximum are rare
+	constexpr double cell_max_safety = 1.3;
+
+	LOGenerator::LOGenerator(const Config &generator_config, const double generator_ptmin, const uint64_t seed,
+		const unsigned int nthreads, const unsigned int generator_ncells_pt, 
+		const unsigned int generator_ncells_y, const unsigned int npoints)
+	{
+		config = generator_config;
+		ptmin = generator_ptmin;
+		ncells_pt = generator_ncells_pt;
+		ncells_y = generator_ncells_y;
+
+		//weights in the corners of the cells with index [(i*nnodes_y + j)*nnodes_y + k]
+		const unsigned int nnodes_y = ncells_y + 1;
+		std::vector<double> node_weights((ncells_pt + 1)*nnodes_y*nnodes_y);
+		ParallelFor(ncells_pt + 1, nthreads, [&](const unsigned long i)
+		{
+			PartonEvent event;
+			for (unsigned int j = 0; j < nnodes_y; j++)
+			{
+				for (unsigned int k = 0; k < nnodes_y; k++)
+				{
+					const double u[3] = {static_cast<double>(i)/ncells_pt, 
+						static_cast<double>(j)/ncells_y, static_cast<double>(k)/ncells_y};
+					node_weights[(i*nnodes_y + j)*nnodes_y + k] = GetWeight(u, event);
+				}
+			}
+		});
+
+		cell_max.assign(ncells_pt*ncells_y*ncells_y, 0.);
+		ParallelFor(ncells_pt, nthreads, [&](const unsigned long i)
+		{
+			RandomStream rand(seed, GetStreamId(kEvents, 0), i);
+			PartonEvent event;
+			for (unsigned int j = 0; j < ncells_y; j++)
+			{
+				for (unsigned int k = 0; k < ncells_y; k++)
+				{
+					double maximum = 0.;
+					for (unsigned int corner = 0; corner < 8; corner++)
+					{
+						maximum = Maximum(maximum, node_weights[((i + (corner & 1))*nnodes_y + 
+							j + ((corner >> 1) & 1))*nnodes_y + k + (corner >> 2)]);
+					}
+					for (unsigned int point = 0; point < npoints; point++)
+					{
+						const double u[3] = {(i + rand.Uniform())/ncells_pt, 
+							(j + rand.Uniform())/ncells_y, (k + rand.Uniform())/ncells_y};
+						maximum = Maximum(maximum, GetWeight(u, event));
+					}
+					cell_max[(i*ncells_y + j)*ncells_y + k] = maximum*cell_max_safety;
+				}
+			}
+		});
+
+		cell_cumulative.resize(cell_max.size());
+		double sum = 0.;
+		for (unsigned long cell = 0; cell < cell_max.size(); cell++)
+		{
+			sum += cell_max[cell];
+			cell_cumulative[cell] = sum;
+		}
+		if (sum <= 0.) throw std::runtime_error("LOGenerator: no phase space above ptmin");
+		for (double &value : cell_cumulative) value /= sum;
+
+		//all cells have the same volume
+		envelope = sum/static_cast<double>(cell_max.size());
+	}
+
+	double LOGenerator::GetWeight(const double *u, PartonEvent &event) const
+	{
+		const PowerLawMap pt_map = PowerLawMap(ptmin, config.energy/2., config.pt_map_power);
+		double pt_jacobian, y1_jacobian, y2_jacobian;
+		const double pt = pt_map.Map(u[0], pt_jacobian);
+		const double xt = 2.*pt/config.energy;
+
+		const double max_y = DijetKinematics::MaxRapidity(xt);
+		const UniformMap y1_map = UniformMap(-max_y, max_y);
+		if (y1_map.IsEmpty()) return 0.;
+		const double y1 = y1_map.Map(u[1], y1_jacobian);
+
+		double y2min, y2max;
+		DijetKinematics::Y2Range(xt, y1, y2min, y2max);
+		const UniformMap y2_map = UniformMap(y2min, y2max);
+		if (y2_map.IsEmpty()) return 0.;
+		const double y2 = y2_map.Map(u[2], y2_jacobian);
+
+		event.pt = pt;
+		event.y3 = y1;
+		event.y4 = y2;
+		event.x1 = X1(pt, config.energy, y1, y2);
+		event.x2 = X2(pt, config.energy, y1, y2);
+
+		//protection from the rounding at the edges of the range
+		if (event.x1 >= 1. || event.x2 >= 1.) return 0.;
+
+		const double s = config.energy*config.energy*event.x1*event.x2;
+		return Integrand(config, pt, s, y1, y2, event.x1, event.x2)*pt_jacobian*y1_jacobian*y2_jacobian;
+	}
+
+	//PDG code of the flavour from -5 to 5 where 0 is gluon
+	int GetPDGId(const int flavour) {return (flavour == 0) ? 21 : flavour;}
+
+	//index of the term of the cumulative sums selected by the uniform number
+	unsigned int SelectTerm(const double *cumulative, const unsigned int n, const double uniform)
+	{
+		const unsigned int term = std::upper_bound(cumulative, cumulative + n, uniform*cumulative[n - 1]) - cumulative;
+		return Minimum(term, n - 1);
+	}
+
+	void LOGenerator::SetFlavours(PartonEvent &event, RandomStream &rand) const
+	{
+		const PDFSource *pdf = GetPDF(config.pdfset_name);
+		thread_local std::vector<double> xf1_all, xf2_all;
+		pdf->xfxQ2(event.x1, event.pt*event.pt, xf1_all);
+		pdf->xfxQ2(event.x2, event.pt*event.pt, xf2_all);
+
+		const double s = config.energy*config.energy*event.x1*event.x2;
+		double cs[kNChannels];
+		GetChannelCS<double>(event.pt, s, event.y3, event.y4, cs);
+
+		//contributions of the pairs of flavours with index [(flavour1 + 5)*nflavours + flavour2 + 5]
+		double cumulative[nflavours*nflavours];
+		double sum = 0.;
+		for (int i = 0; i < nflavours; i++)
+		{
+			for (int j = 0; j < nflavours; j++)
+			{
+				sum += Maximum(xf1_all[i + 1]*xf2_all[j + 1]*cs[channel_table[i][j]], 0.);
+				cumulative[i*nflavours + j] = sum;
+			}
+		}
+		const unsigned int pair = SelectTerm(cumulative, nflavours*nflavours, rand.Uniform());
+		const int flavour1 = pair/nflavours - 5;
+		const int flavour2 = pair%nflavours - 5;
+		event.id1 = GetPDGId(flavour1);
+		event.id2 = GetPDGId(flavour2);
+		event.id3 = event.id1;
+		event.id4 = event.id2;
+
+		//processes of the channels with several final states are selected by their cross sections
+		double cos_theta = CosTheta<double>(s, event.pt);
+		if (event.y3 - event.y4 < 0) cos_theta *= -1.;
+		const double t = MandelstamT<double>(s, cos_theta);
+		const double u = MandelstamU<double>(s, cos_theta);
+
+		const Channel channel = channel_table[flavour1 + 5][flavour2 + 5];
+		if (channel == kGG)
+		{
+			const double processes[2] = {CS_GG_GG(s, t, u), CS_GG_GG(s, t, u) + CS_GG_QQbar(s, t, u)};
+			if (SelectTerm(processes, 2, rand.Uniform()) == 1)
+			{
+				const int quark = 1 + Minimum(static_cast<int>(5.*rand.Uniform()), 4);
+				event.id3 = quark;
+				event.id4 = -quark;
+			}
+		}
+		else if (channel == kQQbar)
+		{
+			double processes[3];
+			processes[0] = CS_QQbar_QQbar(s, t, u);
+			processes[1] = processes[0] + CS_QQbar_GG(s, t, u);
+			processes[2] = processes[1] + CS_QQbar_QpQbarp(s, t, u);
+			const unsigned int process = SelectTerm(processes, 3, rand.Uniform());
+			if (process == 1)
+			{
+				event.id3 = 21;
+				event.id4 = 21;
+			}
+			else if (process == 2)
+			{
+				//one of the 4 other flavours
+				int quark = 1 + Minimum(static_cast<int>(4.*rand.Uniform()), 3);
+				if (quark >= abs(flavour1)) quark++;
+				event.id3 = (flavour1 > 0) ? quark : -quark;
+				event.id4 = -event.id3;
+			}
+		}
+	}
+
+	void LOGenerator::Generate(const unsigned long nevents, RandomStream &rand, 
+		std::vector<PartonEvent> &events, GeneratorStat &stat) const
+	{
+		const unsigned long ncells = cell_max.size();
+		const unsigned long first = events.size();
+		while (events.size() - first < nevents)
+		{
+			const unsigned long cell = SelectTerm(cell_cumulative.data(), ncells, rand.Uniform());
+			const unsigned int i = cell/(ncells_y*ncells_y);
+			const unsigned int j = (cell/ncells_y)%ncells_y;
+			const unsigned int k = cell%ncells_y;
+			const double u[3] = {(i + rand.Uniform())/ncells_pt, 
+				(j + rand.Uniform())/ncells_y, (k + rand.Uniform())/ncells_y};
+
+			PartonEvent event;
+			const double weight = GetWeight(u, event);
+			stat.ntries++;
+			if (weight > cell_max[cell]) stat.nviolations++;
+			if (weight <= 0. || weight < rand.Uniform()*cell_max[cell]) continue;
+
+			stat.naccepted++;
+			SetFlavours(event, rand);
+			events.push_back(event);
+		}
+	}
+
+	MCResult LOGenerator::GetSigma(const GeneratorStat &stat) const
+	{
+		MCResult result;
+		if (stat.ntries < 1.) return result;
+		const double efficiency = stat.naccepted/stat.ntries;
+		result.value = envelope*efficiency;
+		result.error = envelope*sqrt(efficiency*(1. - efficiency)/stat.ntries);
+		return result;
+	}
+
+	void DsigmaDpTDy1Dy2(const Config &config, const unsigned long n,
+		const double *pt, const double *y1, const double *y2, double *result)
+	{
+		for (unsigned long i = 0; i < n; i++) result[i] = DsigmaDpTDy1Dy2(config, pt[i], y1[i], y2[i]);
+	}
+
+	//threads of the batch functions live as long as the process so the PDFs of the threads are loaded 
+	//only at the first call; there is one pool for every requested number of threads
+	ThreadPool &GetThreadPool(const unsigned int nthreads)
+	{
+		static std::map<unsigned int, std::unique_ptr<ThreadPool>> pools;
+		static std::mutex pools_mutex;
+
+		std::lock_guard<std::mutex> lock(pools_mutex);
+		std::unique_ptr<ThreadPool> &pool = pools[nthreads];
+		if (!pool) pool = std::make_unique<ThreadPool>(nthreads);
+		return *pool;
+	}
+
+	void GetDsigma(const Config &config, const Observable observable, const unsigned long n,
+		const double *x, const Cuts &cuts, const double ntries, const uint64_t seed,
+		const unsigned int nthreads, double *value, double *error)
+	{
+		ThreadPool &pool = GetThreadPool(nthreads);
+		std::vector<std::future<void>> results;
+		for (unsigned long i = 0; i < n; i++)
+		{
+			results.push_back(pool.Submit([&, i]
+			{
+				RandomStream rand(seed, GetStreamId(observable, i));
+				const MCResult result = GetDsigma(config, observable, x[i], cuts, ntries, rand).GetResult();
+				value[i] = result.value;
+				error[i] = result.error;
+			}));
+		}
+
+		//the tasks use the arrays so all of them are finished before the first exception is rethrown
+		std::exception_ptr exception;
+		for (std::future<void> &result : results)
+		{
+			try {result.get();}
+			catch (...) {if (!exception) exception = std::current_exception();}
+		}
+		if (exception) std::rethrow_exception(exception);
+	}
+}
+
+//message of the last error of the C interface in the current thread
+static thread_local std::string last_error;
+
+static DijetXS::Config GetConfig(const char *pdfset_name, const double energy, const int precision)
+{
+	DijetXS::Config config;
+	config.pdfset_name = pdfset_name;
+	config.energy = energy;
+	config.precision = static_cast<DijetXS::Precision>(precision);
+	return config;
+}
+
+//exceptions must not cross the C interface so they are turned into the error code -1
+int dijetxs_dsigma_dpt_dy1dy2(const char *pdfset_name, const double energy, const int precision,
+	const unsigned long n, const double *pt, const double *y1, const double *y2, double *result)
+{
+	try
+	{
+		DijetXS::DsigmaDpTDy1Dy2(GetConfig(pdfset_name, energy, precision), n, pt, y1, y2, result);
+	}
+	catch (const std::exception &exception)
+	{
+		last_error = exception.what();
+		return -1;
+	}
+	return 0;
+}
+
+int dijetxs_dsigma(const char *pdfset_name, const double energy, const int precision,
+	const int observable, const unsigned long n, const double *x, const double ptmin,
+	const double abs_max_y, const double ntries, const unsigned long seed,
+	const unsigned int nthreads, double *value, double *error)
+{
+	try
+	{
+		const DijetXS::Cuts cuts = {ptmin, abs_max_y};
+		DijetXS::GetDsigma(GetConfig(pdfset_name, energy, precision), 
+			static_cast<DijetXS::Observable>(observable), n, x, cuts, ntries, seed, nthreads, value, error);
+	}
+	catch (const std::exception &exception)
+	{
+		last_error = exception.what();
+		return -1;
+	}
+	return 0;
+}
+
+long dijetxs_convolve_grids(const char *file_name, const char *pdfset_name, 
+	const unsigned long max_n, double *value, double *error)
+{
+	try
+	{
+		std::vector<DijetXS::InterpolationGrid> grids;
+		if (!DijetXS::ReadGrids(file_name, grids)) 
+		{
+			last_error = std::string("Grids file ") + file_name + " cannot be read";
+			return -1;
+		}
+
+		for (unsigned long i = 0; i < grids.size() && i < max_n; i++)
+		{
+			const DijetXS::MCResult result = DijetXS::Convolve(grids[i], pdfset_name);
+			value[i] = result.value;
+			error[i] = result.error;
+		}
+		return grids.size();
+	}
+	catch (const std::exception &exception)
+	{
+		last_error = exception.what();
+		return -1;
+	}
+}
+
+const char *dijetxs_get_error()
+{
+	return last_error.c_str();
+}
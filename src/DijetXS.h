@@ -0,0 +1,293 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <iostream>
+#include <cstdint>
+
+#include "../lib/RandomStream.h"
+
+//leading order dijet cross sections in pb computed with LHAPDF
+//all functions are thread safe: all parameters are passed explicitly and every thread
+//uses its own copy of the PDF so the library can be called from any number of threads
+namespace DijetXS
+{
+	//precision of the integrand: kFloat is for the fast exploratory runs
+	//and kValidate computes both and reports the deviation of the float integrand from the double one
+	enum Precision {kDouble, kFloat, kValidate};
+
+	//observables that are used to separate random streams; kEvents is for the streams of LOGenerator
+	enum Observable {kDsigmaDpT, kDsigmaDdy, kEvents};
+
+	//parameters of the calculation that do not change from point to point
+	struct Config
+	{
+		double energy = 7000.;
+		std::string pdfset_name = "NNPDF31_lo_as_0118";
+		//pT in dsigma/dDeltay is sampled as pT^(-pt_map_power) which is close to the shape of the integrand
+		double pt_map_power = 4.;
+		Precision precision = kDouble;
+		//number of the nodes of the interpolation grids in x1 (and x2) and in the factorization scale
+		unsigned int grid_nx = 20;
+		unsigned int grid_nq2 = 8;
+	};
+
+	//acceptance of the integration; ptmin is used only in dsigma/dDeltay
+	struct Cuts
+	{
+		double ptmin;
+		double abs_max_y;
+	};
+
+	//value and statistical error of the monte-carlo integral
+	struct MCResult
+	{
+		double value = 0.;
+		double error = 0.;
+	};
+
+	//sums of the estimates of the integral (integrand times jacobian) over n tries
+	struct MCSum
+	{
+		double sum = 0.;
+		double sum2 = 0.;
+		double n = 0.;
+
+		void Add(const double estimate);
+		//adds the tries of another independent block
+		void Add(const MCSum &block);
+		MCResult GetResult() const;
+	};
+
+	//deviation of the low precision integrand from the double one in the validation mode
+	struct PrecisionStat
+	{
+		double max_deviation = 0.;
+		double sum_deviation2 = 0.;
+		double sum_double = 0.;
+		double sum_float = 0.;
+		double n = 0.;
+
+		void Add(const PrecisionStat &stat);
+	};
+
+	//channels of the incoming partons: gg, gq, qq, qqbar, and qq'
+	constexpr int nchannels = 5;
+
+	//PDF independent weights of the cross section in one point (fastNLO/APPLgrid-like)
+	//the cross section with any PDF is the sum over channels c and nodes (i, j, k) of
+	//weight(c, i, j, k)*alpha_s^2(q2_k)*L_c(x_i, x_j, q2_k) where L_c is the sum of xf1*xf2 over the channel
+	//xf is interpolated by the 3rd order Lagrange polynomials in x nodes uniform in ln(1/x) + 5(1 - x)
+	//from xmin to 1 and in q2 nodes uniform in ln(q2) from q2min to q2max
+	class InterpolationGrid
+	{
+		private:
+		unsigned int nx = 0, nq2 = 0;
+		std::vector<double> x_nodes, q2_nodes;
+		//index [((channel*nx + i)*nx + j)*nq2 + k]
+		std::vector<double> weights;
+
+		public :
+
+		Observable observable = kDsigmaDpT;
+		//point of the observable
+		double x = 0.;
+		//cross section with the PDF used during the filling; its relative error
+		//is the statistical error of the cross sections with other PDFs
+		MCResult reference;
+
+		InterpolationGrid() = default;
+		InterpolationGrid(const Observable grid_observable, const double grid_x, const double xmin, 
+			const double q2min, const double q2max, const unsigned int grid_nx, const unsigned int grid_nq2);
+
+		//adds the weights of all channels (dsigma without alpha_s^2 and PDFs) in the point (x1, x2, q2)
+		void Fill(const double x1, const double x2, const double q2, const double *channel_weights);
+		void Scale(const double scale);
+
+		unsigned int GetNx() const {return nx;}
+		unsigned int GetNq2() const {return nq2;}
+		double GetXNode(const unsigned int i) const {return x_nodes[i];}
+		double GetQ2Node(const unsigned int k) const {return q2_nodes[k];}
+		double GetWeight(const int channel, const unsigned int i, const unsigned int j, const unsigned int k) const
+		{
+			return weights[((channel*nx + i)*nx + j)*nq2 + k];
+		}
+
+		void Write(std::ostream &output) const;
+		bool Read(std::istream &input);
+	};
+
+	//source of xf and alpha_s used by the integrand: the LHAPDF member or the member
+	//of the PDF set in the shared memory segment (see lib/SharedPDF.h)
+	class PDFSource
+	{
+		public :
+		virtual ~PDFSource() = default;
+		//xf of the flavours from -6 to 6 with index id + 6
+		virtual void xfxQ2(const double x, const double q2, std::vector<double> &xf) const = 0;
+		virtual double alphasQ2(const double q2) const = 0;
+	};
+
+	//PDF of the current thread: pdfset_name is the LHAPDF set name (name/member for the member)
+	//or shm:/dijetxs_<set>[/<member>] for the set in the shared memory segment created by SharePDF(<set>)
+	//throws std::runtime_error if the segment is not available
+	const PDFSource *GetPDF(const std::string &pdfset_name);
+
+	//name of the shared memory segment with the LHAPDF set, e.g. /dijetxs_NNPDF31_lo_as_0118
+	std::string GetSharedPDFName(const std::string &pdfset_name);
+
+	//tabulates all members of the LHAPDF set on nx*nq2 nodes in the shared memory segment 
+	//GetSharedPDFName(pdfset_name) that stays until UnsharePDF is called or the node reboots
+	//returns false if the segment already exists or cannot be created
+	bool SharePDF(const std::string &pdfset_name, const unsigned int nx = 300, const unsigned int nq2 = 120);
+	bool UnsharePDF(const std::string &pdfset_name);
+
+	//maximum deviation of xf and alpha_s of the member of the set in the shared memory segment from LHAPDF
+	//inside the grid, at its edges, and outside of it where the shared values are compared with LHAPDF
+	//at the nearest edge; xf deviation is relative to the largest |xf| at the point
+	//throws std::runtime_error if the segment or the member is not available
+	double CheckSharedPDF(const std::string &pdfset_name, const unsigned int member = 0);
+
+	uint64_t GetStreamId(const Observable observable, const int bin);
+
+	//dsigma/dpTdy1dy2; 0 outside of the kinematically allowed region
+	double DsigmaDpTDy1Dy2(const Config &config, const double pt, const double y1, const double y2);
+
+	//dsigma/dpT (x is pT) or dsigma/dDeltay (x is Deltay) integrated with ntries tries
+	MCSum GetDsigma(const Config &config, const Observable observable, const double x,
+		const Cuts &cuts, const double ntries, RandomStream &rand);
+
+	//dsigma for several cut sets from one sampling over their widest acceptance (the smallest ptmin and
+	//the largest |ymax|): every point is added to the integrals of all cut sets that accept it and 
+	//dsigma/dDeltay of every set is averaged over its own [0, |ymax|]; for one cut set the result is 
+	//the same as of GetDsigma with this random stream; there can be up to 64 cut sets
+	std::vector<MCSum> GetDsigma(const Config &config, const Observable observable, const double x,
+		const std::vector<Cuts> &cut_sets, const double ntries, RandomStream &rand);
+
+	//integrates in blocks of ntries tries until the relative error is below the precision
+	//or max_blocks blocks were used; block b uses the random stream (seed, stream, b)
+	MCResult GetDsigmaPrecise(const Config &config, const Observable observable, const double x,
+		const Cuts &cuts, const double precision, const unsigned int max_blocks,
+		const double ntries, const uint64_t seed, const uint64_t stream);
+
+	//same as GetDsigma but also fills the grid whose ranges are set from the cuts
+	MCSum FillGrid(const Config &config, const Observable observable, const double x,
+		const Cuts &cuts, const double ntries, RandomStream &rand, InterpolationGrid &grid);
+
+	//cross section from the grid with the PDF set (LHAPDF name or name/member)
+	//and its alpha_s or with alpha_s(q2) passed as alphas_q2
+	MCResult Convolve(const InterpolationGrid &grid, const std::string &pdfset_name);
+	MCResult Convolve(const InterpolationGrid &grid, const std::string &pdfset_name, 
+		std::function<double(double)> alphas_q2);
+
+	//binary files with the grids; Read returns false if the file cannot be read
+	bool WriteGrids(const std::string &file_name, const std::vector<InterpolationGrid> &grids);
+	bool ReadGrids(const std::string &file_name, std::vector<InterpolationGrid> &grids);
+
+	//batch versions: the results for n points are written into the passed arrays
+	void DsigmaDpTDy1Dy2(const Config &config, const unsigned long n,
+		const double *pt, const double *y1, const double *y2, double *result);
+
+	//point i is integrated with the random stream (seed, GetStreamId(observable, i)) in nthreads threads
+	//so the results are the same as in the histograms of analytic.cpp with the same bin centers
+	//nthreads 0 means the number of hardware threads; the threads are kept between the calls
+	//so the PDF is loaded by every thread only once
+	void GetDsigma(const Config &config, const Observable observable, const unsigned long n,
+		const double *x, const Cuts &cuts, const double ntries, const uint64_t seed,
+		const unsigned int nthreads, double *value, double *error);
+
+	//2->2 parton event of LOGenerator; ids are PDG codes (21 is gluon)
+	struct PartonEvent
+	{
+		//incoming partons with the momentum fractions x1 and x2
+		int id1, id2;
+		double x1, x2;
+		//outgoing partons with the transverse momentum pt and the rapidities y3 and y4
+		int id3, id4;
+		double pt, y3, y4;
+	};
+
+	//statistics of the unweighting of LOGenerator
+	struct GeneratorStat
+	{
+		double ntries = 0.;
+		double naccepted = 0.;
+		//tries with the weight above the maximum of their cell; such events are accepted 
+		//and the distribution is biased if there are many of them
+		double nviolations = 0.;
+
+		void Add(const GeneratorStat &stat);
+	};
+
+	//unweighted LO dijet events with pT > ptmin in the whole kinematic range from dsigma/dpTdy1dy2
+	//the weight is dsigma/dpTdy1dy2 times the jacobian in the unit cube of (u_pT, u_y1, u_y2) where pT 
+	//is sampled as pT^(-pt_map_power) and y1 and y2 are uniform in their kinematic ranges
+	//stage 1 (the constructor) finds the maximum of the weight in every cell of the grid in the cube
+	//from the weights in the corners of the cell and in npoints random points inside it
+	//stage 2 (Generate) picks the cell with the probability proportional to its maximum, accepts 
+	//the uniform point in it with the probability weight/maximum, and selects the flavours of the 
+	//incoming partons proportionally to their contributions and then the process of the channel
+	class LOGenerator
+	{
+		private:
+		Config config;
+		double ptmin;
+		unsigned int ncells_pt, ncells_y;
+		//maxima of the weight in the cells with index [(i*ncells_y + j)*ncells_y + k] for pT, y1, and y2
+		std::vector<double> cell_max;
+		//cumulative sums of the maxima normalized to 1
+		std::vector<double> cell_cumulative;
+		//integral of the maxima over the cube; the cross section is envelope*naccepted/ntries
+		double envelope = 0.;
+
+		//maps the point of the cube into the event kinematics and returns its weight
+		double GetWeight(const double *u, PartonEvent &event) const;
+		void SetFlavours(PartonEvent &event, RandomStream &rand) const;
+
+		public :
+
+		//the maxima are searched in nthreads threads (0 means the number of hardware threads)
+		//with the random streams (seed, GetStreamId(kEvents, 0), pT cell)
+		LOGenerator(const Config &generator_config, const double generator_ptmin, const uint64_t seed,
+			const unsigned int nthreads = 0, const unsigned int generator_ncells_pt = 40, 
+			const unsigned int generator_ncells_y = 20, const unsigned int npoints = 4);
+
+		//appends nevents unweighted events to events and adds the unweighting statistics to stat
+		//thread safe: different threads can generate with their own random streams
+		void Generate(const unsigned long nevents, RandomStream &rand, 
+			std::vector<PartonEvent> &events, GeneratorStat &stat) const;
+
+		//cross section of the generated events in pb
+		MCResult GetSigma(const GeneratorStat &stat) const;
+	};
+
+	//returns the validation statistics accumulated by the current thread and resets it
+	PrecisionStat TakePrecisionStat();
+
+	//returns the number of integrand calls made by the current thread since the last call
+	unsigned long TakeIntegrandCalls();
+}
+
+//C interface for the bindings to other languages (e.g. src/dijetxs.py)
+//precision and observable are the values of DijetXS::Precision and DijetXS::Observable
+//the functions return -1 on errors (e.g. unknown PDF set) and dijetxs_get_error returns the message
+extern "C"
+{
+	//return 0 on success
+	int dijetxs_dsigma_dpt_dy1dy2(const char *pdfset_name, const double energy, const int precision,
+		const unsigned long n, const double *pt, const double *y1, const double *y2, double *result);
+
+	int dijetxs_dsigma(const char *pdfset_name, const double energy, const int precision,
+		const int observable, const unsigned long n, const double *x, const double ptmin,
+		const double abs_max_y, const double ntries, const unsigned long seed,
+		const unsigned int nthreads, double *value, double *error);
+
+	//returns the number of the grids in the file or -1 if it cannot be read
+	//results of the first max_n grids are written into value and error
+	long dijetxs_convolve_grids(const char *file_name, const char *pdfset_name, 
+		const unsigned long max_n, double *value, double *error);
+
+	//message of the last error in the calling thread
+	const char *dijetxs_get_error();
+}
@@ -1,273 +1,722 @@
 #include <iostream>
 #include <string>
 #include <cmath>
+#include <mutex>
+#include <sstream>
+#include <iomanip>
+#include <unordered_map>
+#include <list>
+#include <algorithm>
+#include <atomic>
+#include <memory>
 
 #include "TFile.h"
 #include "TH1.h"
-#include "TRandom.h"
-
-#include "LHAPDF/LHAPDF.h"
 
 #include "../lib/ProgressBar.h"
 #include "../lib/Box.h"
 #include "../lib/Tool.h"
+#include "../lib/RandomStream.h"
+#include "../lib/ThreadPool.h"
+#include "../lib/SocketServer.h"
+#include "../lib/RunStats.h"
+#include "../lib/CutSets.h"
+#include "../lib/MultiWeightHist.h"
+#include "../lib/AsyncNtupleWriter.h"
+
+#include "DijetXS.h"
 
-using namespace LHAPDF;
 using namespace Tool;
+using namespace DijetXS;
 
 struct
 {
 	//input parameters
 	const double energy = 7000;
+	//LHAPDF set or shm:/dijetxs_<set>[/<member>] of the set written into the shared memory by --share-pdf <set>
 	std::string pdfset_name = "NNPDF31_lo_as_0118";
 	const double abs_max_y = 4.7;
 	const double ptmin = 25;
-	const double ntries = 1e5;
+	//additional acceptances {ptmin, |ymax|} integrated from the same samples as the nominal one above
+	//(the samples cover the widest acceptance); their histograms get the suffix _ptmin<ptmin>_ymax<|ymax|>
+	//e.g. {{25., 2.5}, {50., 4.7}, {100., 4.7}}
+	std::vector<Cuts> cut_sets = {};
+	double ntries = 1e5;
+	//number of bins of both histograms
+	unsigned int nbins = 200;
+	//pT in dsigma/dDeltay is sampled as pT^(-pt_map_power) which is close to the shape of the integrand
+	const double pt_map_power = 4.;
+
+	//every bin is integrated with its own random stream (seed, observable, bin)
+	//so the result for the given seed does not depend on the number of threads
+	//seed 0 means that the seed is taken from the current time
+	unsigned int seed = 0;
+	//0 means the number of hardware threads
+	unsigned int nthreads = 0;
+
+	//precision of the integrand: kFloat is for the fast exploratory runs
+	//and kValidate computes both and reports the deviation of the float integrand from the double one
+	const Precision precision = kDouble;
+
+	//server mode (./analytic.exe --serve [socket path]) integrates every bin 
+	//in blocks of ntries until the requested precision or server_max_blocks blocks
+	std::string socket_path = "/tmp/dijetxs.sock";
+	const unsigned int server_max_blocks = 100;
+	//maximum number of the cached results of the bins
+	const unsigned long server_max_cache_size = 1000000;
+
+	//./analytic.exe --fill-grids also writes the PDF independent interpolation grids of all bins
+	//and ./analytic.exe --convolve <pdfset> computes the histograms from them with another PDF set
+	//(LHAPDF name or name/member) without the integration
+	//the grids file is written into output_dir
+	std::string grids_file_name = "analytic_grids.dat";
+	const unsigned int grid_nx = 20;
+	const unsigned int grid_nq2 = 8;
 
-	//other parameters
-	const double s = energy*energy;
-	const PDF *pdf = mkPDF(pdfset_name);
-	TRandom rand;
+	//./analytic.exe --gen-lo [nevents] generates unweighted LO parton events with pT > ptmin 
+	//from dsigma/dpTdy1dy2 (DijetXS::LOGenerator) and writes the parton histograms with the same names
+	//as generate.cpp into gen_lo.root; the events are generated in parallel in blocks of gen_block_size 
+	//with the random streams (seed, kEvents, block) so they do not depend on the number of threads
+	double gen_nevents = 1e6;
+	const unsigned long gen_block_size = 10000;
+	//cells of the search of the maximum of the weight in pT and in every rapidity
+	const unsigned int gen_ncells_pt = 40;
+	const unsigned int gen_ncells_y = 20;
+	//also writes the events into the TTree lo_events of ntuple_lo.root in output_dir
+	bool gen_write_ntuple = false;
+
+	//./analytic.exe --check-pdf [pdfset] compares the set in the shared memory with LHAPDF (DijetXS::CheckSharedPDF)
+	//and fails if the deviation is above this value; the segment is created for the check if it does not exist
+	const double pdf_check_tolerance = 1e-3;
+
+	//the parameters above can be changed by the command line options (see PrintUsage)
+	std::string output_dir = "../output";
+	//wall time, peak memory, and number of integrand calls are written into this file if it is not empty
+	std::string stats_file_name = "";
+
+	//--serve, --fill-grids, --convolve, --gen-lo, --share-pdf, --unshare-pdf, --check-pdf, or empty for the usual integration and its argument
+	std::string mode = "";
+	std::string mode_argument = "";
 } Par;
 
-unsigned int GetRandomSeed()
+void PrintUsage()
 {
-	auto now = std::chrono::high_resolution_clock::now();
-	auto now_ms = std::chrono::time_point_cast<std::chrono::milliseconds>(now);
-	auto epoch = now_ms.time_since_epoch();
-	auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(epoch);
-	return static_cast<unsigned int>(duration.count() % 900000000);
+	std::cout << "Usage: ./analytic.exe [mode [argument]] [options]" << std::endl;
+	std::cout << "Modes:" << std::endl;
+	std::cout << " --serve [socket]     answer the requests on the unix socket (default " << Par.socket_path << ")" << std::endl;
+	std::cout << " --fill-grids         also write the interpolation grids of all bins" << std::endl;
+	std::cout << " --convolve [pdfset]  compute the histograms from the grids with the PDF set" << std::endl;
+	std::cout << " --gen-lo [nevents]   generate unweighted LO parton events (default " << Par.gen_nevents << ")" << std::endl;
+	std::cout << " --share-pdf [pdfset] tabulate the PDF set in the shared memory for all processes on the node" << std::endl;
+	std::cout << " --unshare-pdf [pdfset] remove the PDF set from the shared memory" << std::endl;
+	std::cout << " --check-pdf [pdfset] compare the PDF set in the shared memory with LHAPDF" << std::endl;
+	std::cout << "Options:" << std::endl;
+	std::cout << " -p pdfset     PDF set; shm:/dijetxs_<set>[/member] for the shared one (default " << Par.pdfset_name << ")" << std::endl;
+	std::cout << " -n ntries     number of tries per bin (default " << Par.ntries << ")" << std::endl;
+	std::cout << " -b nbins      number of bins of the histograms (default " << Par.nbins << ")" << std::endl;
+	std::cout << " -s seed       seed of the random streams (default from the current time)" << std::endl;
+	std::cout << " -j n          number of threads (default all)" << std::endl;
+	std::cout << " -o dir        output directory (default " << Par.output_dir << ")" << std::endl;
+	std::cout << " --stats file  write the wall time, peak memory, and number of integrand calls" << std::endl;
+	std::cout << " --cuts ptmin:ymax  also integrate the acceptance pT > ptmin, |y| < ymax; can be repeated" << std::endl;
+	std::cout << " --ntuple      write the events of --gen-lo into ntuple_lo.root" << std::endl;
 }
 
-//cross sections dsigma/dOmega for different processes
-//qq'->qq'
-double CS_QQp_QQp(const double s, const double t, const double u)
+void ReadArguments(int argc, char **argv)
 {
-	return 1./(9.*s)*(s*s + u*u)/(t*t);
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		if (arg == "-h" || arg == "--help")
+		{
+			PrintUsage();
+			exit(0);
+		}
+		if (arg == "--serve" || arg == "--fill-grids" || arg == "--convolve" || 
+			arg == "--share-pdf" || arg == "--unshare-pdf" || arg == "--check-pdf" || arg == "--gen-lo")
+		{
+			Par.mode = arg;
+			if (arg != "--fill-grids" && i + 1 < argc && argv[i + 1][0] != '-') Par.mode_argument = argv[++i];
+			continue;
+		}
+		if (arg == "--ntuple")
+		{
+			Par.gen_write_ntuple = true;
+			continue;
+		}
+		if (i + 1 >= argc) PrintError("Option " + arg + " requires a value");
+		const std::string value = argv[++i];
+		if (arg == "-p") Par.pdfset_name = value;
+		else if (arg == "-n") Par.ntries = std::stod(value);
+		else if (arg == "-b") Par.nbins = std::stoi(value);
+		else if (arg == "-s") Par.seed = std::stoul(value);
+		else if (arg == "-j") Par.nthreads = std::stoi(value);
+		else if (arg == "-o") Par.output_dir = value;
+		else if (arg == "--stats") Par.stats_file_name = value;
+		else if (arg == "--cuts")
+		{
+			const unsigned long colon = value.find(':');
+			if (colon == std::string::npos) PrintError("Cut set " + value + " is not of the form ptmin:ymax");
+			Par.cut_sets.push_back({std::stod(value.substr(0, colon)), std::stod(value.substr(colon + 1))});
+		}
+		else PrintError("Unknown option " + arg);
+	}
 }
 
-//qq->qq
-double CS_QQ_QQ(const double s, const double t, const double u)
+//parameters of the library calculation
+Config GetConfig()
 {
-	return 1./(9.*s)*((t*t + s*s)/(u*u) + (s*s + u*u)/(t*t) - 2.*s*s/(3.*u*t));
+	Config config;
+	config.energy = Par.energy;
+	config.pdfset_name = Par.pdfset_name;
+	config.pt_map_power = Par.pt_map_power;
+	config.precision = Par.precision;
+	config.grid_nx = Par.grid_nx;
+	config.grid_nq2 = Par.grid_nq2;
+	return config;
 }
 
-//qqbar->q'qbar'
-double CS_QQbar_QpQbarp(const double s, const double t, const double u)
+//number of integrand calls in all threads
+std::atomic<unsigned long> ncalls(0);
+
+//statistics of all threads in the validation mode
+PrecisionStat precision_stat;
+std::mutex precision_stat_mutex;
+
+void PrintPrecisionStat()
 {
-	return 1./(9.*s)*(t*t + u*u)/(s*s);
+	Box box("Float integrand validation");
+	box.AddEntry("Number of points", static_cast<unsigned long>(precision_stat.n));
+	box.AddEntry("Max relative deviation", precision_stat.max_deviation, 8);
+	box.AddEntry("RMS relative deviation", sqrt(precision_stat.sum_deviation2/precision_stat.n), 8);
+	box.AddEntry("Deviation of the sum", precision_stat.sum_float/precision_stat.sum_double - 1., 8);
+	box.Print();
 }
 
-//qqbar->qqbar
-double CS_QQbar_QQbar(const double s, const double t, const double u)
+//nominal acceptance followed by the additional ones
+std::vector<Cuts> GetCutSets()
 {
-	return 1./(9.*s)*((t*t + u*u)/(s*s) + (s*s + u*u)/(t*t) - 2.*u*u/(3.*s*t));
+	std::vector<Cuts> cut_sets = {{Par.ptmin, Par.abs_max_y}};
+	cut_sets.insert(cut_sets.end(), Par.cut_sets.begin(), Par.cut_sets.end());
+	if (cut_sets.size() > CutSets::max_size) PrintError("Too many cut sets");
+	return cut_sets;
 }
 
-//qqbar->gg
-double CS_QQbar_GG(const double s, const double t, const double u)
+//histograms of the first nsets cut sets; the nominal one keeps the name
+std::vector<TH1D> MakeHists(const std::string &name, const std::string &title, 
+	const double xmax, const unsigned long nsets)
 {
-	return 8./(27.*s)*(t*t + u*u)*(1./(t*u) - 9./(4.*s*s));
+	const std::vector<Cuts> cut_sets = GetCutSets();
+	std::vector<TH1D> hists;
+	for (unsigned long c = 0; c < nsets && c < cut_sets.size(); c++)
+	{
+		const std::string suffix = (c == 0) ? "" : CutSets::GetSuffix(cut_sets[c].ptmin, cut_sets[c].abs_max_y);
+		hists.push_back(TH1D((name + suffix).c_str(), title.c_str(), Par.nbins, 0, xmax));
+	}
+	return hists;
 }
 
-//gg->qqbar
-double CS_GG_QQbar(const double s, const double t, const double u)
+//integrates every bin of the histograms of all cut sets in parallel; all cut sets are integrated 
+//from the same samples of the bin so the additional cut sets cost only the evaluation of the cuts
+//with grids only the nominal cut set is integrated and the interpolation grids of its bins are filled
+void FillHist(std::vector<TH1D> &hists, const Observable observable, const unsigned int seed, 
+	std::string progress_text, std::vector<InterpolationGrid> *grids = nullptr)
 {
-	return 1./(24.*s)*(t*t + u*u)*(1./(t*u) - 9./(4.*s*s));
+	const int nbins = hists[0].GetXaxis()->GetNbins();
+	const std::vector<Cuts> cut_sets = GetCutSets();
+	std::vector<std::vector<MCResult>> result(nbins, std::vector<MCResult>(cut_sets.size()));
+	if (grids) grids->resize(nbins);
+	const Config config = GetConfig();
+
+	ProgressBar pbar = ProgressBar("FANCY");
+	pbar.SetText(progress_text);
+
+	ParallelFor(nbins, Par.nthreads, [&](const unsigned long i)
+	{
+		RandomStream rand(seed, GetStreamId(observable, i));
+		const double x = hists[0].GetXaxis()->GetBinCenter(i + 1);
+		if (grids) 
+		{
+			result[i][0] = FillGrid(config, observable, x, cut_sets[0], Par.ntries, rand, (*grids)[i]).GetResult();
+		}
+		else 
+		{
+			const std::vector<MCSum> sums = GetDsigma(config, observable, x, cut_sets, Par.ntries, rand);
+			for (unsigned long c = 0; c < cut_sets.size(); c++) result[i][c] = sums[c].GetResult();
+		}
+
+		ncalls += TakeIntegrandCalls();
+		if (Par.precision == kValidate)
+		{
+			std::lock_guard<std::mutex> lock(precision_stat_mutex);
+			precision_stat.Add(TakePrecisionStat());
+		}
+	}, [&](const double progress) {pbar.Print(progress);});
+
+	for (unsigned long c = 0; c < hists.size(); c++)
+	{
+		for (int i = 1; i <= nbins; i++) 
+		{
+			hists[c].SetBinContent(i, result[i - 1][c].value);
+			hists[c].SetBinError(i, result[i - 1][c].error);
+		}
+	}
 }
 
-//gq->gq
-double CS_GQ_GQ(const double s, const double t, const double u)
+//results of the server for every set of bin parameters; the least recently used results 
+//are removed when there are more than server_max_cache_size of them
+//the list keeps the keys from the most recently used one
+std::list<std::string> server_cache_order;
+std::unordered_map<std::string, std::pair<MCResult, std::list<std::string>::iterator>> server_cache;
+std::mutex server_cache_mutex;
+
+//returns false if the result is not in the cache
+bool FindCachedResult(const std::string &key, MCResult &result)
 {
-	return 1./(9.*s)*(s*s + u*u)*(-1./(s*u) + 9./(4.*t*t));
+	std::lock_guard<std::mutex> lock(server_cache_mutex);
+	auto search = server_cache.find(key);
+	if (search == server_cache.end()) return false;
+	result = search->second.first;
+	server_cache_order.splice(server_cache_order.begin(), server_cache_order, search->second.second);
+	return true;
 }
 
-//gg->gg
-double CS_GG_GG(const double s, const double t, const double u)
+void AddCachedResult(const std::string &key, const MCResult &result)
 {
-	return 9./(8.*s)*(3. - (u*t)/(s*s) - (s*u)/(t*t) - (s*t)/(u*u));
+	std::lock_guard<std::mutex> lock(server_cache_mutex);
+	auto search = server_cache.find(key);
+	if (search != server_cache.end())
+	{
+		search->second.first = result;
+		server_cache_order.splice(server_cache_order.begin(), server_cache_order, search->second.second);
+		return;
+	}
+	server_cache_order.push_front(key);
+	server_cache[key] = {result, server_cache_order.begin()};
+	while (server_cache.size() > Par.server_max_cache_size)
+	{
+		server_cache.erase(server_cache_order.back());
+		server_cache_order.pop_back();
+	}
 }
 
-//variables shortcuts
-double CosTheta(const double s, const double pt) {return sqrt(1.-(4.*pt*pt/s));}
-double T(const double s, const double cos_theta) {return -s/2.*(1.-cos_theta);}
-double U(const double s, const double cos_theta) {return -s/2.*(1.+cos_theta);}
-
-//returns dsigma/dOmega for id1+id2->X+X process
-//y = y1 - y2
-double CS_XX_XX(const int id1, const int id2, const double s, const double pt, const double y)
+//request: <dpt|ddy> <ptmin> <|ymax|> <relative precision> <bin edge 0> ... <bin edge n>
+//response: ok <value 1> <error 1> ... <value n> <error n> or error <message>
+//the values are computed at the bin centers in the same way as in the histograms
+std::string AnswerRequest(const std::string &line, ThreadPool &pool, const unsigned int seed)
 {
-	double cos_theta = CosTheta(s, pt);
-	if (y < 0) cos_theta *= -1.;
+	std::istringstream request(line);
+	std::string observable_name;
+	Cuts cuts;
+	double precision;
 	
-	const double t = T(s, cos_theta);
-	const double u = U(s, cos_theta);
-
-	const double alpha_s = Par.pdf->alphasQ2(pt*pt);
+	request >> observable_name >> cuts.ptmin >> cuts.abs_max_y >> precision;
+	if (request.fail()) return "error wrong format of the request";
 	
-	double result = 0.;
-	if (id1 == 0 && id2 == 0)
+	std::vector<double> edges;
+	for (double edge; request >> edge;) edges.push_back(edge);
+	if (!request.eof()) return "error wrong format of the bin edges";
+	if (edges.size() < 2) return "error at least 2 bin edges are needed";
+	if (!(cuts.ptmin > 0.)) return "error ptmin must be positive";
+	if (!(cuts.abs_max_y > 0.)) return "error |ymax| must be positive";
+	if (!(precision > 0.)) return "error relative precision must be positive";
+	for (unsigned long i = 0; i + 1 < edges.size(); i++)
 	{
-		result = CS_GG_GG(s, t, u) + CS_GG_QQbar(s, t, u);
+		if (!(edges[i] < edges[i + 1])) return "error bin edges must increase";
 	}
-	else if (id2 == 0 || id1 == 0)
+
+	Observable observable;
+	if (observable_name == "dpt") observable = kDsigmaDpT;
+	else if (observable_name == "ddy") observable = kDsigmaDdy;
+	else return "error unknown observable " + observable_name;
+
+	std::vector<MCResult> results(edges.size() - 1);
+	std::vector<std::future<MCResult>> futures(edges.size() - 1);
+	std::vector<std::string> keys(edges.size() - 1);
+
+	const Config config = GetConfig();
+	for (unsigned long i = 0; i < results.size(); i++)
 	{
-		result = CS_GQ_GQ(s, t, u);
+		const double x = (edges[i] + edges[i + 1])/2.;
+		
+		std::ostringstream key;
+		key << std::hexfloat << observable << " " << x << " " << 
+			cuts.ptmin << " " << cuts.abs_max_y << " " << precision;
+		keys[i] = key.str();
+
+		if (FindCachedResult(keys[i], results[i])) continue;
+
+		const std::string bin_key = keys[i];
+		futures[i] = pool.Submit([=]
+		{
+			//block b of the bin uses the random stream (seed, hash of parameters, b)
+			//so the result depends only on the parameters and the seed
+			return GetDsigmaPrecise(config, observable, x, cuts, precision, 
+				Par.server_max_blocks, Par.ntries, seed, HashStr(bin_key));
+		});
+	}
+
+	std::ostringstream response;
+	response << "ok" << std::setprecision(12);
+	for (unsigned long i = 0; i < results.size(); i++)
+	{
+		if (futures[i].valid())
+		{
+			results[i] = futures[i].get();
+			AddCachedResult(keys[i], results[i]);
+		}
+		response << " " << results[i].value << " " << results[i].error;
 	}
-	else if (id1 == id2)
+	return response.str();
+}
+
+//the exceptions of the calculation (e.g. the PDF set that cannot be loaded) are returned 
+//as the error response instead of terminating the server
+std::string HandleRequest(const std::string &line, ThreadPool &pool, const unsigned int seed)
+{
+	try
 	{
-		result = CS_QQ_QQ(s, t, u);
+		return AnswerRequest(line, pool, seed);
 	}
-	else if (id1 == -id2)
+	catch (const std::exception &error)
 	{
-		result = CS_QQbar_QQbar(s, t, u) + CS_QQbar_GG(s, t, u) + CS_QQbar_QpQbarp(s, t, u);
+		return std::string("error ") + error.what();
 	}
-	else result = CS_QQp_QQp(s, t, u);
-	return result*alpha_s*alpha_s;
 }
 
-double X1(const double pt, const double sqrt_s, const double y1, const double y2)
+//keeps the PDFs loaded in the threads of the pool and answers the requests on the unix socket
+void RunServer(const std::string &socket_path, const unsigned int seed)
 {
-	return 2.*pt/sqrt_s*exp((y1+y2)/2.)*cosh((y1-y2)/2.);
+	ThreadPool pool(Par.nthreads);
+
+	//loading the PDF in every thread of the pool before the first request
+	//by evaluating the cross section in one point
+	const Config config = GetConfig();
+	std::vector<std::future<void>> warmup;
+	for (unsigned int i = 0; i < pool.GetNthreads(); i++) 
+	{
+		warmup.push_back(pool.Submit([=] {DsigmaDpTDy1Dy2(config, Par.ptmin, 0., 0.);}));
+	}
+	try
+	{
+		for (std::future<void> &future : warmup) future.get();
+	}
+	catch (const std::exception &error) {PrintError(error.what());}
+
+	SocketServer server(socket_path);
+	server.Run([&](const std::string &line) {return HandleRequest(line, pool, seed);});
 }
 
-double X2(const double pt, const double sqrt_s, const double y1, const double y2)
+//fills the histograms from the grids file convolved with the PDF set
+//the grids are written in the order of the bins: first dsigma/dpT and then dsigma/dDeltay
+void ConvolveGrids(const std::string &pdfset_name, const std::string &grids_file_name, 
+	TH1D &dsigma_dpt, TH1D &dsigma_ddy)
 {
-	return 2.*pt/sqrt_s*exp(-(y1+y2)/2.)*cosh((y1-y2)/2.);
+	std::vector<InterpolationGrid> grids;
+	if (!ReadGrids(grids_file_name, grids))
+	{
+		PrintError("Grids cannot be read from " + grids_file_name + "; run ./analytic.exe --fill-grids first");
+	}
+
+	const int nbins_dpt = dsigma_dpt.GetXaxis()->GetNbins();
+	const int nbins_ddy = dsigma_ddy.GetXaxis()->GetNbins();
+	if (static_cast<int>(grids.size()) != nbins_dpt + nbins_ddy)
+	{
+		PrintError("Number of grids in " + grids_file_name + " does not match the number of bins");
+	}
+
+	std::vector<MCResult> result(grids.size());
+	ParallelFor(grids.size(), Par.nthreads, [&](const unsigned long i)
+	{
+		result[i] = Convolve(grids[i], pdfset_name);
+	});
+
+	for (int i = 1; i <= nbins_dpt; i++) 
+	{
+		dsigma_dpt.SetBinContent(i, result[i - 1].value);
+		dsigma_dpt.SetBinError(i, result[i - 1].error);
+	}
+	for (int i = 1; i <= nbins_ddy; i++) 
+	{
+		dsigma_ddy.SetBinContent(i, result[nbins_dpt + i - 1].value);
+		dsigma_ddy.SetBinError(i, result[nbins_dpt + i - 1].error);
+	}
 }
 
-double DsigmaDpTDy1Dy2(const double pt, const double s, const double y1, const double y2, const double x1, const double x2)
+//fills pT of the partons in |y| < |ymax| and Deltay of the pairs in the acceptance of every cut set
+void FillEvent(const PartonEvent &event, const CutSets &cut_sets, 
+	std::vector<MultiWeightHist> &pt_hists, std::vector<MultiWeightHist> &dy_hists)
 {
-	double result = 0.;
-	
-	//summation over pairs of flavours
-	for (int id1 = -5; id1 <= 5; id1++)
+	const double weight = 1.;
+	const uint64_t y3_mask = cut_sets.GetYMask(event.y3);
+	const uint64_t y4_mask = cut_sets.GetYMask(event.y4);
+	for (uint64_t mask = y3_mask; mask; mask &= mask - 1) pt_hists[CutSets::GetFirst(mask)].Fill(event.pt, &weight);
+	for (uint64_t mask = y4_mask; mask; mask &= mask - 1) pt_hists[CutSets::GetFirst(mask)].Fill(event.pt, &weight);
+
+	const double delta_y = fabs(event.y3 - event.y4);
+	for (uint64_t mask = y3_mask & y4_mask & cut_sets.GetPtMask(event.pt); mask; mask &= mask - 1)
 	{
-		for (int id2 = -5; id2 <= 5; id2++)
-		{
-			result += 8.*M_PI*pt*
-				Par.pdf->xfxQ2(id1, x1, pt*pt)*Par.pdf->xfxQ2(id2, x2, pt*pt)*
-				CS_XX_XX(id1, id2, s, pt, y1 - y2)/(s)*1e9;
-			//1e9 is to get pb instead of mb
-		}
+		dy_hists[CutSets::GetFirst(mask)].Fill(delta_y, &weight);
 	}
-	return result;
 }
 
-//dsigma/dpT
-double GetDsigmaDpT(const double pt)
-{	
-	double result = 0.;
-	double n = 0.;
-	
-	for (double i = 0; i < Par.ntries; i++)
+//writes the number of events histogram and dsigma normalized with the cross section per event
+void WriteHists(const MultiWeightHist &raw, const std::string &dsigma_name, const double sigma_per_event)
+{
+	TH1D raw_hist = raw.GetTH1D();
+	TH1D dsigma_hist = raw.GetTH1D();
+	dsigma_hist.SetName(dsigma_name.c_str());
+	dsigma_hist.Scale(sigma_per_event/raw.GetBinWidth());
+
+	raw_hist.Write();
+	dsigma_hist.Write();
+}
+
+//generates unweighted LO events and writes the parton histograms of all cut sets into gen_lo.root
+//returns the number of generated events
+unsigned long GenerateLOEvents(const unsigned int seed)
+{
+	const unsigned long nevents = static_cast<unsigned long>(Par.gen_nevents);
+	const std::vector<Cuts> cut_set_list = GetCutSets();
+	CutSets cut_sets;
+	for (const Cuts &cuts : cut_set_list) cut_sets.Add(cuts.ptmin, cuts.abs_max_y);
+	const double ptmin = cut_sets.GetMinPtmin();
+
+	//Deltay range covers the widest acceptance as in generate.cpp
+	const double dy_max = static_cast<double>(ceil(cut_sets.GetMaxAbsMaxY()*2.));
+	std::vector<MultiWeightHist> pt_hists, dy_hists;
+	for (const Cuts &cuts : cut_set_list)
 	{
-		(void)i;
-		
-		const double y1 = Par.rand.Uniform(0., Par.abs_max_y);
-		const double y2 = Par.rand.Uniform(-Par.abs_max_y, Par.abs_max_y);
-		
-		//checking if the pt is within the kinematicaly possible range
-		if (pt > Par.energy/(2.*cosh(abs(y1-y2)/2.))) continue;
-		
-		double x1 = X1(pt, Par.energy, y1, y2);
-		double x2 = X2(pt, Par.energy, y1, y2);
-		const double s = Par.s*x1*x2;
-		
-		//checking if x1 and x2 are within the kinematicaly possible range
-		if (x1 >= 1. || x2 >= 1.) continue;
-		
-		result += DsigmaDpTDy1Dy2(pt, s, y1, y2, x1, x2);
-		n+= 1.;
+		const std::string suffix = (pt_hists.size() == 0) ? "" : CutSets::GetSuffix(cuts.ptmin, cuts.abs_max_y);
+		pt_hists.push_back(MultiWeightHist("part_mult_pt" + suffix, "dsigma/dpt", Par.nbins, 0., 200.));
+		dy_hists.push_back(MultiWeightHist("part_mult_dy" + suffix, "dsigma/ddy", Par.nbins, 0., dy_max));
+	}
+
+	PrintInfo("Searching for the maxima of the weight");
+	const LOGenerator generator = LOGenerator(GetConfig(), ptmin, seed, Par.nthreads, 
+		Par.gen_ncells_pt, Par.gen_ncells_y);
+
+	system(("mkdir -p " + Par.output_dir).c_str());
+	std::unique_ptr<AsyncNtupleWriter> ntuple;
+	if (Par.gen_write_ntuple)
+	{
+		ntuple = std::make_unique<AsyncNtupleWriter>(Par.output_dir + "/ntuple_lo.root", "lo_events", 
+			std::vector<std::string>{"id1", "id2", "id3", "id4", "x1", "x2", "pt", "y3", "y4"});
 	}
-	return result*2.*Par.abs_max_y*Par.abs_max_y/n;
-}
 
-//dsigma/d dDeltay
-double GetDsigmaDdy(const double delta_y)
-{	
-	double result = 0.;
-	double n = 0.;
+	//blocks are generated in parallel in chunks and filled in the order of the blocks
+	//so the histograms and the ntuple do not depend on the number of threads
+	const unsigned long nblocks = (nevents + Par.gen_block_size - 1)/Par.gen_block_size;
+	const unsigned long chunk_size = 64;
+	GeneratorStat stat;
 
-	const double ptmax = Par.energy/(2.*cosh(delta_y/2.));
-	if (ptmax <= Par.ptmin) return 0.;
+	ProgressBar pbar = ProgressBar("FANCY");
+	pbar.SetText("LO events");
 
-	for (int i = 0; i < Par.ntries; i++)
+	for (unsigned long first_block = 0; first_block < nblocks; first_block += chunk_size)
 	{
-		(void)i;
-		const double pt = Par.rand.Uniform(Par.ptmin, ptmax);
-		const double y1 = Par.rand.Uniform(0., Par.abs_max_y);
-		
-		double y2 = y1 - delta_y;
-		
-		//keeps track if the try was kinematicaly possible
-		bool success = false;
-		if (y2 < Par.abs_max_y)
+		const unsigned long nchunk_blocks = Minimum(chunk_size, nblocks - first_block);
+		std::vector<std::vector<PartonEvent>> events(nchunk_blocks);
+		std::vector<GeneratorStat> stats(nchunk_blocks);
+
+		ParallelFor(nchunk_blocks, Par.nthreads, [&](const unsigned long i)
 		{
-			const double x1 = X1(pt, Par.energy, y1, y2);
-			const double x2 = X2(pt, Par.energy, y1, y2);
-							
-			if (x1 < 1. && x2 < 1.)
-			{
-				result += DsigmaDpTDy1Dy2(pt, Par.s*x1*x2, y1, y2, x1, x2);
-				success = true;
-			}
-		}
-		y2 = delta_y + y1;
-		if (abs(y2) <= Par.abs_max_y)
+			const unsigned long block = first_block + i;
+			RandomStream rand(seed, GetStreamId(kEvents, 1), block);
+			const unsigned long block_nevents = Minimum(Par.gen_block_size, nevents - block*Par.gen_block_size);
+			events[i].reserve(block_nevents);
+			generator.Generate(block_nevents, rand, events[i], stats[i]);
+			ncalls += TakeIntegrandCalls();
+		});
+
+		for (unsigned long i = 0; i < nchunk_blocks; i++)
 		{
-			const double x1 = X1(pt, Par.energy, y1, y2);
-			const double x2 = X2(pt, Par.energy, y1, y2);
-				
-			if (x1 < 1. && x2 < 1.)
+			stat.Add(stats[i]);
+			for (const PartonEvent &event : events[i])
 			{
-				result += DsigmaDpTDy1Dy2(pt, Par.s*x1*x2, y1, y2, x1, x2);
-				success = true;
+				FillEvent(event, cut_sets, pt_hists, dy_hists);
+				if (ntuple)
+				{
+					ntuple->Fill({static_cast<float>(event.id1), static_cast<float>(event.id2), 
+						static_cast<float>(event.id3), static_cast<float>(event.id4), 
+						static_cast<float>(event.x1), static_cast<float>(event.x2), 
+						static_cast<float>(event.pt), static_cast<float>(event.y3), static_cast<float>(event.y4)});
+				}
 			}
 		}
-		if (success) n += 1.;
+		pbar.Print(static_cast<double>(first_block + nchunk_blocks)/static_cast<double>(nblocks));
+	}
+
+	if (ntuple) 
+	{
+		ntuple->Close();
+		PrintInfo("File " + Par.output_dir + "/ntuple_lo.root was written");
+	}
+
+	const MCResult sigma = generator.GetSigma(stat);
+
+	Box box = Box("LO generator");
+	box.AddEntry("Events", static_cast<unsigned long>(stat.naccepted));
+	box.AddEntry("Efficiency", stat.naccepted/stat.ntries, 4);
+	box.AddEntry("Weights above the maximum, %", stat.nviolations/stat.ntries*100., 4);
+	box.AddEntry("Cross section, pb", sigma.value);
+	box.AddEntry("Cross section error, pb", sigma.error);
+	box.Print();
+
+	if (stat.nviolations > 1e-3*stat.naccepted)
+	{
+		PrintWarning("Many weights are above the maxima of their cells: increase the numbers of cells");
+	}
+
+	TH1D gen_info = TH1D("gen_info", "info", 2, 0, 2);
+	gen_info.SetBinContent(1, stat.naccepted);
+	gen_info.SetBinContent(2, sigma.value);
+	gen_info.SetBinError(2, sigma.error);
+
+	const std::string output_file_name = Par.output_dir + "/gen_lo.root";
+	TFile output = TFile(output_file_name.c_str(), "RECREATE");
+
+	gen_info.Write();
+	for (unsigned long c = 0; c < cut_set_list.size(); c++)
+	{
+		const std::string suffix = (c == 0) ? "" : CutSets::GetSuffix(cut_set_list[c].ptmin, cut_set_list[c].abs_max_y);
+		WriteHists(pt_hists[c], "part_dsigma_dpt" + suffix, sigma.value/stat.naccepted);
+		WriteHists(dy_hists[c], "part_dsigma_ddy" + suffix, sigma.value/stat.naccepted);
 	}
-	if (n < 1.) return 0.;
-	return result*(ptmax - Par.ptmin)/n;
+
+	output.Close();
+	PrintInfo("File " + output_file_name + " was written");
+
+	return nevents;
 }
 
-int main()
+int main(int argc, char **argv)
 {
-	Par.rand.SetSeed(GetRandomSeed());
-	TH1D dsigma_dpt = TH1D("dsigma_dpt", "dsigma/dpT", 200, 0, 200);
-	TH1D dsigma_ddy = TH1D("dsigma_ddy", "dsigma/dDeltay", 200, 0, 
-		static_cast<double>(ceil(Par.abs_max_y*2)));
-	
-	ProgressBar pbar = ProgressBar("FANCY");
-	pbar.SetText("dsigma/dpT");
-	
-	//performing monte-carlo integration for dsigma/dpT and filling the hist with the result
-	for (int i = 1; i <= dsigma_dpt.GetXaxis()->GetNbins(); i++)
+	RunStats stats;
+	ReadArguments(argc, argv);
+
+	const unsigned int seed = (Par.seed == 0) ? GetRandomSeed() : Par.seed;
+	PrintInfo("Seed " + std::to_string(seed));
+
+	if (Par.mode == "--share-pdf" || Par.mode == "--unshare-pdf")
+	{
+		const std::string pdfset_name = (Par.mode_argument != "") ? Par.mode_argument : Par.pdfset_name;
+		const std::string segment_name = GetSharedPDFName(pdfset_name);
+		if (Par.mode == "--unshare-pdf")
+		{
+			if (!UnsharePDF(pdfset_name)) PrintError("Shared memory segment " + segment_name + " cannot be removed");
+			PrintInfo("Shared memory segment " + segment_name + " was removed");
+			return 0;
+		}
+		if (!SharePDF(pdfset_name)) PrintError("Shared memory segment " + segment_name + " cannot be created");
+		PrintInfo("PDF set " + pdfset_name + " was written into the shared memory; use it as shm:" + segment_name);
+		return 0;
+	}
+
+	if (Par.mode == "--check-pdf")
+	{
+		const std::string pdfset_name = (Par.mode_argument != "") ? Par.mode_argument : Par.pdfset_name;
+		const bool is_created = SharePDF(pdfset_name);
+		double deviation = 0.;
+		try {deviation = CheckSharedPDF(pdfset_name);}
+		catch (const std::exception &error) {PrintError(error.what());}
+		if (is_created) UnsharePDF(pdfset_name);
+
+		if (Par.stats_file_name != "")
+		{
+			stats.Add("pdf_deviation", deviation);
+			if (!stats.Write(Par.stats_file_name)) PrintError("File " + Par.stats_file_name + " cannot be created");
+		}
+		const std::string message = "Shared PDF set " + pdfset_name + " deviates from LHAPDF by " + DtoStr(deviation, 6);
+		if (deviation > Par.pdf_check_tolerance) PrintError(message + " > " + DtoStr(Par.pdf_check_tolerance, 6));
+		PrintInfo(message);
+		return 0;
+	}
+
+	if (Par.mode == "--serve")
+	{
+		RunServer((Par.mode_argument != "") ? Par.mode_argument : Par.socket_path, seed);
+		return 0;
+	}
+
+	if (Par.mode == "--gen-lo")
 	{
-		pbar.Print(static_cast<double>(i)/static_cast<double>(dsigma_dpt.GetXaxis()->GetNbins()));
-		const double pt = dsigma_dpt.GetXaxis()->GetBinCenter(i);
-		dsigma_dpt.SetBinContent(i, GetDsigmaDpT(pt));
+		if (Par.mode_argument != "") Par.gen_nevents = std::stod(Par.mode_argument);
+		const unsigned long nevents = GenerateLOEvents(seed);
+		if (Par.stats_file_name != "")
+		{
+			stats.Add("events", static_cast<double>(nevents));
+			stats.Add("events_per_second", static_cast<double>(nevents)/stats.GetWallTime());
+			stats.Add("integrand_calls", static_cast<double>(ncalls));
+			if (!stats.Write(Par.stats_file_name)) PrintError("File " + Par.stats_file_name + " cannot be created");
+		}
+		return 0;
+	}
+
+	//Deltay range covers the widest acceptance
+	double abs_max_y = Par.abs_max_y;
+	for (const Cuts &cuts : Par.cut_sets) abs_max_y = Maximum(abs_max_y, cuts.abs_max_y);
+
+	//grids are filled and convolved only for the nominal cut set
+	const bool is_nominal_only = (Par.mode == "--fill-grids" || Par.mode == "--convolve");
+	if (Par.mode == "--fill-grids" && Par.cut_sets.size() > 0)
+	{
+		PrintWarning("Grids are filled only for the nominal cut set; the other cut sets are not integrated");
 	}
-	pbar.Print(1);
+	const unsigned long nsets = is_nominal_only ? 1 : GetCutSets().size();
+
+	std::vector<TH1D> dsigma_dpt = MakeHists("dsigma_dpt", "dsigma/dpT", 200., nsets);
+	std::vector<TH1D> dsigma_ddy = MakeHists("dsigma_ddy", "dsigma/dDeltay", 
+		static_cast<double>(ceil(abs_max_y*2)), nsets);
 	
-	pbar.Reset();
-	pbar.SetText("dsigma/ddy");
+	system(("mkdir -p " + Par.output_dir).c_str());
+	std::string output_file_name = Par.output_dir + "/analytic.root";
+	const std::string grids_file_name = Par.output_dir + "/" + Par.grids_file_name;
 
-	//performing monte-carlo integration for dsigma/ddeltay and filling the hist with the result
-	for (int i = 1; i <= dsigma_ddy.GetXaxis()->GetNbins(); i++)
+	if (Par.mode == "--convolve")
+	{
+		std::string pdfset_name = (Par.mode_argument != "") ? Par.mode_argument : Par.pdfset_name;
+		ConvolveGrids(pdfset_name, grids_file_name, dsigma_dpt[0], dsigma_ddy[0]);
+
+		std::replace(pdfset_name.begin(), pdfset_name.end(), '/', '_');
+		output_file_name = Par.output_dir + "/analytic_" + pdfset_name + ".root";
+	}
+	else
 	{
-		pbar.Print(static_cast<double>(i)/static_cast<double>(dsigma_ddy.GetXaxis()->GetNbins()));
-		const double delta_y = dsigma_ddy.GetXaxis()->GetBinCenter(i);
-		dsigma_ddy.SetBinContent(i, GetDsigmaDdy(delta_y));
+		std::vector<InterpolationGrid> dpt_grids, ddy_grids;
+		const bool fill_grids = (Par.mode == "--fill-grids");
+
+		//performing monte-carlo integration for dsigma/dpT and dsigma/ddeltay 
+		//and filling the hists with the result
+		FillHist(dsigma_dpt, kDsigmaDpT, seed, "dsigma/dpT", fill_grids ? &dpt_grids : nullptr);
+		FillHist(dsigma_ddy, kDsigmaDdy, seed, "dsigma/ddy", fill_grids ? &ddy_grids : nullptr);
+
+		if (Par.precision == kValidate) PrintPrecisionStat();
+
+		if (fill_grids)
+		{
+			dpt_grids.insert(dpt_grids.end(), ddy_grids.begin(), ddy_grids.end());
+			if (!WriteGrids(grids_file_name, dpt_grids)) 
+			{
+				PrintError("Grids cannot be written into " + grids_file_name);
+			}
+			PrintInfo("File " + grids_file_name + " was written");
+		}
 	}
-	pbar.Print(1);
 	
-	system("mkdir ../output");
-	TFile output = TFile("../output/analytic.root", "RECREATE");
+	TFile output = TFile(output_file_name.c_str(), "RECREATE");
 
-	dsigma_dpt.Write();
-	dsigma_ddy.Write();
+	for (TH1D &hist : dsigma_dpt) hist.Write();
+	for (TH1D &hist : dsigma_ddy) hist.Write();
 
 	output.Close();
+	PrintInfo("File " + output_file_name + " was written");
+
+	if (Par.stats_file_name != "")
+	{
+		stats.Add("integrand_calls", static_cast<double>(ncalls));
+		stats.Add("integrand_calls_per_second", static_cast<double>(ncalls)/stats.GetWallTime());
+		if (!stats.Write(Par.stats_file_name)) PrintError("File " + Par.stats_file_name + " cannot be created");
+	}
 	return 0;
 }
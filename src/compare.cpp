@@ -0,0 +1,269 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cmath>
+#include <mutex>
+
+#include "TROOT.h"
+#include "TFile.h"
+#include "TKey.h"
+#include "TList.h"
+#include "TH1D.h"
+
+#include "../lib/Box.h"
+#include "../lib/ProgressBar.h"
+#include "../lib/ThreadPool.h"
+
+struct
+{
+	//file with the histograms all other files are compared to
+	std::string reference_file_name = "../output/analytic.root";
+	//reference histograms are multiplied by this factor
+	double reference_scale = 1.;
+	//number of bins merged in the rebinned ratios
+	int rebin = 2;
+	//output is written to <output_name>.root and <output_name>.txt
+	std::string output_name = "../output/compare";
+	//0 means the number of hardware threads
+	unsigned int nthreads = 0;
+
+	std::vector<std::string> file_names;
+} Par;
+
+//histograms of one file loaded into memory
+struct LoadedFile
+{
+	std::string name;
+	//prefix of the names of the output objects of the file (see SetLabels)
+	std::string label;
+	std::vector<TH1D *> hists;
+};
+
+//results of the comparison of one histogram with the reference
+struct Comparison
+{
+	std::string file_name, label, hist_name;
+	double chi2 = 0.;
+	int ndf = 0;
+	double mean_ratio = 0.;
+};
+
+void PrintUsage()
+{
+	std::cout << "Usage: ./compare.exe [options] file1.root [file2.root ...]" << std::endl;
+	std::cout << "Every histogram in the files whose name ends with the name of the histogram" << std::endl;
+	std::cout << "in the reference file is compared with it (e.g. jet_dsigma_dpt with dsigma_dpt)" << std::endl;
+	std::cout << "Options:" << std::endl;
+	std::cout << " -r file    reference file (default " << Par.reference_file_name << ")" << std::endl;
+	std::cout << " -s scale   scale of the reference histograms (default " << Par.reference_scale << ")" << std::endl;
+	std::cout << " -b n       number of bins merged in the rebinned ratios (default " << Par.rebin << ")" << std::endl;
+	std::cout << " -o name    output name without extension (default " << Par.output_name << ")" << std::endl;
+	std::cout << " -j n       number of threads reading files (default all)" << std::endl;
+}
+
+void ReadArguments(int argc, char **argv)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		if (arg == "-h" || arg == "--help")
+		{
+			PrintUsage();
+			exit(0);
+		}
+		if (arg.size() == 2 && arg[0] == '-')
+		{
+			if (i + 1 >= argc) PrintError("Option " + arg + " requires a value");
+			const std::string value = argv[++i];
+			if (arg == "-r") Par.reference_file_name = value;
+			else if (arg == "-s") Par.reference_scale = std::stod(value);
+			else if (arg == "-b") Par.rebin = std::stoi(value);
+			else if (arg == "-o") Par.output_name = value;
+			else if (arg == "-j") Par.nthreads = std::stoi(value);
+			else PrintError("Unknown option " + arg);
+		}
+		else Par.file_names.push_back(arg);
+	}
+	if (Par.file_names.size() == 0)
+	{
+		PrintUsage();
+		PrintError("No files to compare were passed");
+	}
+}
+
+//returns the name of the file without the directory and the extension
+std::string GetStem(std::string file_name)
+{
+	file_name = file_name.substr(file_name.find_last_of("/") + 1);
+	return file_name.substr(0, file_name.find_last_of("."));
+}
+
+//reads all 1D histograms from the file; the histograms are detached from the file
+LoadedFile LoadFile(std::string file_name)
+{
+	LoadedFile loaded;
+	loaded.name = file_name;
+
+	TFile file(file_name.c_str());
+	if (!file.IsOpen() || file.IsZombie()) PrintError("File " + file_name + " cannot be opened");
+
+	TIter next(file.GetListOfKeys());
+	while (TKey *key = (TKey *) next())
+	{
+		if (std::string(key->GetClassName()) != "TH1D") continue;
+		TH1D *hist = (TH1D *) key->ReadObj();
+		hist->SetDirectory(nullptr);
+		loaded.hists.push_back(hist);
+	}
+	file.Close();
+	return loaded;
+}
+
+//labels are the names of the files without the directory and the extension; the files with the same name 
+//in different directories (e.g. runA/gen_default.root and runB/gen_default.root of a seed scan) 
+//get the labels f<index of the file>_<name> so their output objects and table rows are not mixed up
+void SetLabels(std::vector<LoadedFile> &files)
+{
+	for (unsigned long i = 0; i < files.size(); i++)
+	{
+		const std::string stem = GetStem(files[i].name);
+		bool is_unique = true;
+		for (unsigned long j = 0; j < files.size(); j++)
+		{
+			if (j != i && GetStem(files[j].name) == stem) is_unique = false;
+		}
+		files[i].label = is_unique ? stem : "f" + std::to_string(i) + "_" + stem;
+	}
+}
+
+bool EndsWith(const std::string &str, const std::string &suffix)
+{
+	if (suffix.size() > str.size()) return false;
+	return str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+//computes ratio and pull of the histogram to the reference evaluated at the bin centers
+//so the histograms can have different binning
+Comparison Compare(const TH1D *hist, const TH1D *reference, const std::string &prefix, TFile &output)
+{
+	Comparison result;
+	result.hist_name = hist->GetName();
+
+	TH1D *ratio = (TH1D *) hist->Clone((prefix + "_ratio").c_str());
+	TH1D *pull = (TH1D *) hist->Clone((prefix + "_pull").c_str());
+	ratio->Reset();
+	pull->Reset();
+
+	double sum_ratio = 0.;
+	for (int i = 1; i <= hist->GetXaxis()->GetNbins(); i++)
+	{
+		const int ref_bin = reference->GetXaxis()->FindBin(hist->GetXaxis()->GetBinCenter(i));
+		const double ref = reference->GetBinContent(ref_bin)*Par.reference_scale;
+		const double ref_err = reference->GetBinError(ref_bin)*Par.reference_scale;
+		const double val = hist->GetBinContent(i);
+		const double err = hist->GetBinError(i);
+
+		if (ref <= 0. || val <= 0.) continue;
+
+		ratio->SetBinContent(i, val/ref);
+		ratio->SetBinError(i, err/ref);
+
+		const double total_err = sqrt(err*err + ref_err*ref_err);
+		if (total_err <= 0.) continue;
+
+		pull->SetBinContent(i, (val - ref)/total_err);
+		result.chi2 += pow((val - ref)/total_err, 2);
+		sum_ratio += val/ref;
+		result.ndf++;
+	}
+	if (result.ndf > 0) result.mean_ratio = sum_ratio/static_cast<double>(result.ndf);
+
+	output.cd();
+	ratio->Write();
+	pull->Write();
+
+	if (Par.rebin > 1)
+	{
+		TH1D *ratio_rebin = (TH1D *) ratio->Rebin(Par.rebin, (prefix + "_ratio_rebin").c_str());
+		ratio_rebin->Scale(1./static_cast<double>(Par.rebin));
+		ratio_rebin->Write();
+		delete ratio_rebin;
+	}
+
+	delete ratio;
+	delete pull;
+	return result;
+}
+
+int main(int argc, char **argv)
+{
+	ReadArguments(argc, argv);
+
+	//files are read in parallel
+	ROOT::EnableThreadSafety();
+	TH1::AddDirectory(false);
+
+	const LoadedFile reference = LoadFile(Par.reference_file_name);
+	std::vector<LoadedFile> files(Par.file_names.size());
+
+	ProgressBar pbar = ProgressBar("FANCY", "Reading");
+	ParallelFor(files.size(), Par.nthreads, [&](const unsigned long i)
+	{
+		files[i] = LoadFile(Par.file_names[i]);
+	}, [&](const double progress) {pbar.Print(progress);});
+	SetLabels(files);
+
+	const std::string output_file_name = Par.output_name + ".root";
+	const std::string table_file_name = Par.output_name + ".txt";
+	TFile output = TFile(output_file_name.c_str(), "RECREATE");
+	std::vector<Comparison> comparisons;
+
+	//draw.py scales the reference histograms by the same value
+	TH1D reference_scale = TH1D("reference_scale", "scale of the reference histograms", 1, 0, 1);
+	reference_scale.SetBinContent(1, Par.reference_scale);
+	reference_scale.Write();
+
+	for (const LoadedFile &file : files)
+	{
+		for (const TH1D *ref_hist : reference.hists)
+		{
+			for (const TH1D *hist : file.hists)
+			{
+				if (!EndsWith(hist->GetName(), ref_hist->GetName())) continue;
+
+				const std::string prefix = file.label + "_" + hist->GetName();
+				comparisons.push_back(Compare(hist, ref_hist, prefix, output));
+				comparisons.back().file_name = file.name;
+				comparisons.back().label = file.label;
+			}
+		}
+		for (TH1D *hist : file.hists) delete hist;
+	}
+	output.Close();
+	for (TH1D *hist : reference.hists) delete hist;
+
+	std::ofstream table(table_file_name);
+	table << "#file label histogram chi2 ndf chi2/ndf mean_ratio" << std::endl;
+	for (const Comparison &comparison : comparisons)
+	{
+		table << comparison.file_name << " " << comparison.label << " " << comparison.hist_name << " " <<
+			comparison.chi2 << " " << comparison.ndf << " " <<
+			((comparison.ndf > 0) ? comparison.chi2/comparison.ndf : 0.) << " " <<
+			comparison.mean_ratio << std::endl;
+	}
+	table.close();
+
+	Box box("Comparison with " + GetStem(Par.reference_file_name));
+	for (const Comparison &comparison : comparisons)
+	{
+		box.AddEntry(comparison.label + " " + comparison.hist_name + " chi2/ndf",
+			(comparison.ndf > 0) ? comparison.chi2/comparison.ndf : 0., 3);
+	}
+	box.Print();
+
+	PrintInfo("File " + output_file_name + " was written");
+	PrintInfo("File " + table_file_name + " was written");
+
+	return 0;
+}
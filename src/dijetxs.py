@@ -0,0 +1,98 @@
+import os
+import ctypes
+import numpy
+
+#python binding of libdijetxs (DijetXS.h); the arrays are passed to the library without copies
+#e.g.
+#   from dijetxs import DijetXS
+#   xs = DijetXS(energy=7000., pdfset_name="NNPDF31_lo_as_0118")
+#   value, error = xs.dsigma_dpt(numpy.linspace(30., 200., 18), abs_max_y=4.7)
+
+precisions = {"double": 0, "float": 1, "validate": 2}
+observables = {"dpt": 0, "ddy": 1}
+
+double_array = numpy.ctypeslib.ndpointer(dtype=numpy.float64, flags="C_CONTIGUOUS")
+
+def load_library(lib_path):
+    lib = ctypes.CDLL(lib_path)
+
+    lib.dijetxs_dsigma_dpt_dy1dy2.restype = ctypes.c_int
+    lib.dijetxs_dsigma_dpt_dy1dy2.argtypes = [ctypes.c_char_p, ctypes.c_double, ctypes.c_int,
+        ctypes.c_ulong, double_array, double_array, double_array, double_array]
+
+    lib.dijetxs_dsigma.restype = ctypes.c_int
+    lib.dijetxs_dsigma.argtypes = [ctypes.c_char_p, ctypes.c_double, ctypes.c_int,
+        ctypes.c_int, ctypes.c_ulong, double_array, ctypes.c_double,
+        ctypes.c_double, ctypes.c_double, ctypes.c_ulong,
+        ctypes.c_uint, double_array, double_array]
+
+    lib.dijetxs_convolve_grids.restype = ctypes.c_long
+    lib.dijetxs_convolve_grids.argtypes = [ctypes.c_char_p, ctypes.c_char_p,
+        ctypes.c_ulong, double_array, double_array]
+
+    lib.dijetxs_get_error.restype = ctypes.c_char_p
+    lib.dijetxs_get_error.argtypes = []
+    return lib
+
+def as_array(values):
+    return numpy.ascontiguousarray(numpy.atleast_1d(values), dtype=numpy.float64)
+
+class DijetXS:
+    def __init__(self, energy=7000., pdfset_name="NNPDF31_lo_as_0118", precision="double",
+        lib_path=os.path.join(os.path.dirname(os.path.abspath(__file__)), "libdijetxs.so")):
+        self.energy = energy
+        self.pdfset_name = pdfset_name.encode()
+        self.precision = precisions[precision]
+        self.lib = load_library(lib_path)
+
+    #the library returns -1 on errors; raises RuntimeError with the message of the library
+    def check(self, code):
+        if code < 0:
+            raise RuntimeError(self.lib.dijetxs_get_error().decode())
+        return code
+
+    #dsigma/dpTdy1dy2 in pb/GeV for arrays of points
+    def dsigma_dpt_dy1dy2(self, pt, y1, y2):
+        pt, y1, y2 = numpy.broadcast_arrays(as_array(pt), as_array(y1), as_array(y2))
+        pt, y1, y2 = as_array(pt), as_array(y1), as_array(y2)
+        result = numpy.zeros(pt.size)
+        self.check(self.lib.dijetxs_dsigma_dpt_dy1dy2(self.pdfset_name, self.energy, self.precision,
+            pt.size, pt, y1, y2, result))
+        return result
+
+    #monte-carlo integrals at the points x; returns the arrays of values and errors
+    #point i uses the random stream (seed, observable, i) so the results for the bin centers
+    #are the same as in the histograms of analytic.cpp with the same seed
+    def dsigma(self, observable, x, ptmin=25., abs_max_y=4.7, ntries=1e5, seed=1, nthreads=0):
+        x = as_array(x)
+        value = numpy.zeros(x.size)
+        error = numpy.zeros(x.size)
+        self.check(self.lib.dijetxs_dsigma(self.pdfset_name, self.energy, self.precision,
+            observables[observable], x.size, x, ptmin, abs_max_y, ntries, seed, nthreads, value, error))
+        return value, error
+
+    #dsigma/dpT in pb/GeV at the pT values
+    def dsigma_dpt(self, pt, **kwargs):
+        return self.dsigma("dpt", pt, **kwargs)
+
+    #dsigma/dDeltay in pb at the Deltay values
+    def dsigma_ddy(self, delta_y, **kwargs):
+        return self.dsigma("ddy", delta_y, **kwargs)
+
+    #integrals at the centers of the bins with the given edges
+    def dsigma_bins(self, observable, edges, **kwargs):
+        edges = as_array(edges)
+        return self.dsigma(observable, (edges[1:] + edges[:-1])/2., **kwargs)
+
+    #cross sections of all points of the grids file written by ./analytic.exe --fill-grids
+    #convolved with the PDF set (LHAPDF name or name/member); no integration is performed
+    #so the scans over PDF sets and members are fast
+    def convolve_grids(self, file_name, pdfset_name=None):
+        if pdfset_name is None:
+            pdfset_name = self.pdfset_name.decode()
+        empty = numpy.zeros(0)
+        ngrids = self.check(self.lib.dijetxs_convolve_grids(file_name.encode(), pdfset_name.encode(), 0, empty, empty))
+        value = numpy.zeros(ngrids)
+        error = numpy.zeros(ngrids)
+        self.check(self.lib.dijetxs_convolve_grids(file_name.encode(), pdfset_name.encode(), ngrids, value, error))
+        return value, error
@@ -8,11 +8,25 @@ ROOT.gStyle.SetOptStat(False)
 ROOT.TH1.AddDirectory(False)
 
 gen_file_name = ["gen_default", "gen_simple"]
+#jets are drawn from the default profile and partons from the parton level profile
+gen_hist_prefix = ["jet_", "part_"]
 legend_name = ["pythia8 LO jets", 
     "pythia8 LO partons"]
 marker_style = [77, 73]
 color = [ROOT.kRed-2, ROOT.kAzure-3]
 
+#scale of the analytic cross sections applied by compare.exe -s; it is written into compare.root
+#so the cross sections are drawn with the same scale as the ratios
+def read_analytic_scale(file_name="../output/compare.root"):
+    compare_file = TFile(file_name)
+    scale_hist = compare_file.Get("reference_scale") if compare_file and not compare_file.IsZombie() else None
+    if not scale_hist:
+        print("No reference_scale in", file_name, "; the analytic cross sections are not scaled")
+        return 1.
+    return scale_hist.GetBinContent(1)
+
+analytic_scale = read_analytic_scale()
+
 def draw_cross_section(hist_name, titleX, titleY, xmin, ymin, xmax, ymax):
     canv = TCanvas("a", "a", 600, 900)
     ROOT.gPad.SetLogy()
@@ -40,7 +54,7 @@ def draw_cross_section(hist_name, titleX, titleY, xmin, ymin, xmax, ymax):
     hist_analytic = analytic_input_file.Get(hist_name).Clone("analytic_" + hist_name)
     hist_analytic.SetLineColor(ROOT.kBlack)
     hist_analytic.SetLineWidth(3)
-    hist_analytic.Scale(1.1, "nosw2")
+    hist_analytic.Scale(analytic_scale, "nosw2")
     
     legend.AddEntry(hist_analytic, "Analytic", "L")
     hist_analytic.DrawClone("SAME L")
@@ -49,7 +63,7 @@ def draw_cross_section(hist_name, titleX, titleY, xmin, ymin, xmax, ymax):
         input_file = TFile("../output/" + gen_file_name[i] + ".root")
 
         print("Reading file named", gen_file_name[i])
-        hist_gen = input_file.Get(hist_name).Clone(gen_file_name[i] + "_" + hist_name)
+        hist_gen = input_file.Get(gen_hist_prefix[i] + hist_name).Clone(gen_file_name[i] + "_" + hist_name)
         hist_gen.SetMarkerStyle(marker_style[i])
         hist_gen.SetMarkerColorAlpha(color[i], 0.7)
         hist_gen.SetLineColorAlpha(color[i], 0.7)
@@ -86,30 +100,20 @@ def draw_ratio(hist_name, titleX, titleY, xmin, ymin, xmax, ymax):
     legend.SetFillColorAlpha(0, 0.)
     legend.SetLineColorAlpha(0, 0.)
 
-    analytic_input_file = TFile("../output/analytic.root")
-    hist_analytic = analytic_input_file.Get(hist_name).Clone("analytic_" + hist_name)
-    hist_analytic.Scale(1.1, "nosw2")
+    #ratios are computed by compare.exe
+    compare_file = TFile("../output/compare.root")
 
     for i in range (len(gen_file_name)) :
-        input_file = TFile("../output/" + gen_file_name[i] + ".root")
-
-        print("Reading file named", gen_file_name[i])
-        hist_gen = input_file.Get(hist_name).Clone(gen_file_name[i] + "_" + hist_name)
+        ratio_name = gen_file_name[i] + "_" + gen_hist_prefix[i] + hist_name + "_ratio_rebin"
+        print("Reading ratio", ratio_name)
+        hist_gen = compare_file.Get(ratio_name).Clone()
         hist_gen.SetMarkerStyle(marker_style[i])
         hist_gen.SetMarkerColorAlpha(color[i], 0.7)
         hist_gen.SetLineColorAlpha(color[i], 0.7)
         hist_gen.SetMarkerSize(2.)
         hist_gen.SetLineWidth(2)
-
-        for j in range(hist_gen.GetXaxis().GetNbins()):
-            div = hist_analytic.GetBinContent(hist_analytic.GetXaxis().FindBin(hist_gen.GetXaxis().GetBinCenter(j)))
-            if div > 0:
-                hist_gen.SetBinContent(j, hist_gen.GetBinContent(j)/div)
-                hist_gen.SetBinError(j, hist_gen.GetBinError(j)/div)
         
         legend.AddEntry(hist_gen.Clone(), legend_name[i], "P E")
-        hist_gen.Rebin(2)
-        hist_gen.Scale(1./2.)
         hist_gen.DrawClone("SAME E X0")
 
     legend.DrawClone()
@@ -2,6 +2,12 @@
 #include <string>
 #include <chrono>
 #include <array>
+#include <sstream>
+#include <limits>
+#include <functional>
+#include <fstream>
+#include <cstdio>
+#include <unistd.h>
 
 #include "Pythia8/Pythia.h"
 
@@ -10,54 +16,547 @@
 
 #include "TFile.h"
 #include "TH1D.h"
+#include "TProfile.h"
 
 #include "../lib/Box.h"
 #include "../lib/ProgressBar.h"
 #include "../lib/InputTool.h"
+#include "../lib/MultiWeightHist.h"
+#include "../lib/AsyncNtupleWriter.h"
+#include "../lib/RandomStream.h"
+#include "../lib/RunStats.h"
+#include "../lib/SharedPDF.h"
+#include "../lib/StrTool.h"
+#include "../lib/CutSets.h"
+#include "../lib/FastJetStrategyTable.h"
 
 using namespace Pythia8;
 
+//range of the generated pT of the hard process and the number of events generated in it
+//pthat_max < 0 means that there is no upper limit
+struct PtHatSlice
+{
+	double pthat_min, pthat_max;
+	double nevents;
+};
+
+//acceptance of partons and jets
+struct CutSet
+{
+	double ptmin, abs_max_y;
+};
+
+//target of the relative statistical error of the cross section in every bin of the histogram
+//with the center in [xmin, xmax]; hist is part_dsigma_dpt, part_dsigma_ddy, jet_dsigma_dpt, or jet_dsigma_ddy
+struct PrecisionTarget
+{
+	std::string hist;
+	double xmin, xmax;
+	double rel_error;
+};
+
 struct
 {
 	const double energy = 7000.;
 	const double ptmin = 25.;
-	const double nevents = 1e4;
 	const double abs_max_y = 4.7;
+	//additional acceptances {ptmin, |ymax|} filled from the same events as the nominal one above;
+	//their histograms get the suffix _ptmin<ptmin>_ymax<|ymax|>, e.g. {{25., 2.5}, {50., 4.7}, {100., 4.7}}
+	std::vector<CutSet> cut_sets = {};
+
+	//slices are generated one after another and stitched into the final cross sections;
+	//they must not overlap i.e. pthat_max of one slice must be equal to pthat_min of the next one
+	//e.g. {{25., 60., 1e4}, {60., 120., 1e4}, {120., -1., 1e4}}
+	std::vector<PtHatSlice> slices = {{ptmin, -1., 1e4}};
+
+	//with the precision targets the number of events of the slices is not fixed: after the first round
+	//of nevents_per_round events in every slice the rounds are generated in the slices that reduce
+	//the errors of the unreached targets the most until all targets are reached or the budget runs out
+	//e.g. {{"jet_dsigma_dpt", 25., 150., 0.02}, {"jet_dsigma_ddy", 0., 8., 0.05}}
+	std::vector<PrecisionTarget> precision_targets = {};
+	double nevents_per_round = 1e3;
+	//budget of the generation with the precision targets: total number of events 
+	//and wall time in seconds; 0 means no limit
+	double max_nevents = 1e7;
+	double max_time = 0.;
+
+	//weighted generation of the hard process with the bias (pT/pthat_min)^bias2_selection_pow
+	//which makes the statistics at large pT comparable with the statistics at threshold
+	bool bias2_selection = false;
+	double bias2_selection_pow = 4.;
 	
 	const double fastjet_r_par = 0.4;
+	//strategy of the events whose multiplicity is not in the calibration table
 	fastjet::Strategy strategy = fastjet::Best;
+	//the strategy of every event is chosen by its number of particles from the table 
+	//cache_dir/fastjet_strategy.txt measured on this machine by ./generate.exe [profile] --calibrate-fastjet:
+	//the clustering of calibration_nevents events is timed with every candidate strategy in every
+	//multiplicity bin; the bins measured with the other profiles are kept so the calibrations add up
+	bool calibrate_fastjet = false;
+	double calibration_nevents = 200;
+	//clustering of every calibration event is repeated until it takes at least this time in seconds
+	const double calibration_min_time = 0.01;
 
+	//pythia PDF set or shm:/dijetxs_<set>[/<member>] of the set written into the shared memory 
+	//by ./analytic.exe --share-pdf <set>; the set passed with -p overrides the one from the profile
 	std::string pdf_set = "LHAPDF6:NNPDF31_lo_as_0118";
+	bool is_pdf_set_passed = false;
+
+	//file with pythia settings; can be passed as the first argument of the program
+	//the name of the output file is gen_<profile name>.root
+	std::string profile = "../input/default.cmnd";
+	//jets are not clustered for the profiles without hadronization (set from the profile)
+	bool do_jets = true;
+
+	//writes per event ntuple with the leading partons and jets and all event weights
+	//into ntuple_<profile name>.root; the file is written by a separate thread
+	bool write_ntuple = false;
+
+	//shower variations evaluated as additional event weights (UncertaintyBands:List)
+	//every weight gets its own set of histograms; leave empty to use only the nominal weight
+	std::vector<std::string> weight_variations = 
+	{
+		"isrfsr_muRfac_0.5 isr:muRfac=0.5 fsr:muRfac=0.5",
+		"isrfsr_muRfac_2.0 isr:muRfac=2.0 fsr:muRfac=2.0"
+	};
+
+	//pythia takes the random numbers of the Philox stream (seed, slice, event) of every event
+	//so every event is reproducible independently of the other events
+	//seed 0 means that the seed is taken from the current time
+	unsigned int seed = 0;
 
 	//neutrinos id set to exclude from the jet algorithm
 	std::set<int> exclude_id = {12, 14, 16, 18};
+
+	//initialization of multiparton interactions is stored in cache_dir and is reused by the other
+	//slices and by the later runs with the same pythia version, energy, PDF set, and profile
+	bool use_init_cache = true;
+	std::string cache_dir = "../cache";
+
+	//the parameters above can be changed by the command line options (see PrintUsage)
+	std::string output_dir = "../output";
+	//wall time, peak memory, and number of events are written into this file if it is not empty
+	std::string stats_file_name = "";
 } Par;
 
+//proton PDF read from the shared memory segment so that the processes on one node
+//do not load their own copies of the PDF set (see lib/SharedPDF.h)
+class SharedMemoryPDF : public PDF
+{
+	private:
+	std::shared_ptr<const SharedPDF::Segment> segment;
+	unsigned int member;
+
+	public :
+
+	SharedMemoryPDF(std::shared_ptr<const SharedPDF::Segment> pdf_segment, const unsigned int pdf_member) : 
+		PDF(2212)
+	{
+		segment = pdf_segment;
+		member = pdf_member;
+	}
+
+	//all flavours are updated at once as in the LHAPDF6 interface of pythia
+	void xfUpdate(int, double x, double Q2) override
+	{
+		//xf of the flavours from -5 to 5 with index id + 5
+		double xf[SharedPDF::nflavours];
+		segment->xfxQ2(member, x, Q2, xf);
+
+		xbbar = xf[0];
+		xcbar = xf[1];
+		xsbar = xf[2];
+		xubar = xf[3];
+		xdbar = xf[4];
+		xg = xf[5];
+		xd = xf[6];
+		xu = xf[7];
+		xs = xf[8];
+		xc = xf[9];
+		xb = xf[10];
+		xgamma = 0.;
+
+		xuVal = xu - xubar;
+		xuSea = xubar;
+		xdVal = xd - xdbar;
+		xdSea = xdbar;
+
+		idSav = 9;
+	}
+};
+
+//segment of the set shm:/dijetxs_<set>[/<member>] and its member; the segment is mapped once 
+//and is shared by the generators of all slices; nullptr if the set is not in the shared memory
+std::shared_ptr<const SharedPDF::Segment> GetSharedSegment(unsigned int &member)
+{
+	static std::shared_ptr<const SharedPDF::Segment> segment;
+
+	std::string segment_name;
+	if (!SharedPDF::ParseName(Par.pdf_set, segment_name, member)) return nullptr;
+	if (segment) return segment;
+
+	segment = std::make_shared<const SharedPDF::Segment>(segment_name);
+	if (!segment->IsOpen()) 
+	{
+		PrintError("Shared memory segment " + segment_name + " is not available; " + 
+			"create it with ./analytic.exe --share-pdf");
+	}
+	if (member >= segment->GetNmembers()) 
+	{
+		PrintError("Shared memory segment " + segment_name + " has no member " + std::to_string(member));
+	}
+	return segment;
+}
+
+//passes the PDF from the shared memory segment to pythia if the set is shm:/dijetxs_<set>[/<member>]
+void SetSharedPDF(Pythia &pythia)
+{
+	unsigned int member;
+	std::shared_ptr<const SharedPDF::Segment> segment = GetSharedSegment(member);
+	if (!segment) return;
+
+	//both beams are protons and use the same mapping of the segment
+	pythia.setPDFPtr(std::make_shared<SharedMemoryPDF>(segment, member), 
+		std::make_shared<SharedMemoryPDF>(segment, member));
+}
+
 struct FastJetVector
 {
 	std::vector<fastjet::PseudoJet> input, inclusive;
 };
 
-unsigned int GetRandomSeed()
+std::string GetStrategyTableFileName() {return Par.cache_dir + "/fastjet_strategy.txt";}
+
+//jet definitions of the candidate strategies; the strategy of every event is chosen by its multiplicity
+//and the clustering time per event is accumulated as a function of the multiplicity
+struct JetClustering
 {
-	auto now = std::chrono::high_resolution_clock::now();
-	auto now_ms = std::chrono::time_point_cast<std::chrono::milliseconds>(now);
-	auto epoch = now_ms.time_since_epoch();
-	auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(epoch);
-	return static_cast<unsigned int>(duration.count()) % 900000000;
+	FastJetStrategyTable table;
+	//jet definitions of the strategies of the table followed by the one with Par.strategy
+	std::vector<fastjet::JetDefinition> jet_defs;
+	//mean clustering time per event in microseconds vs the number of particles
+	TProfile time_profile = TProfile("clustering_time", "clustering time per event, us", 250, 0., 5000.);
+	//number of events clustered with every jet definition
+	std::array<unsigned long, FastJetStrategyTable::nstrategies + 1> nevents = {};
+	double total_time = 0.;
+
+	JetClustering()
+	{
+		for (const fastjet::Strategy strategy : FastJetStrategyTable::strategies)
+		{
+			jet_defs.push_back(fastjet::JetDefinition(fastjet::antikt_algorithm, Par.fastjet_r_par, strategy));
+		}
+		jet_defs.push_back(fastjet::JetDefinition(fastjet::antikt_algorithm, Par.fastjet_r_par, Par.strategy));
+		table.Read(GetStrategyTableFileName());
+	}
+
+	//index of the jet definition for the event with the given number of particles
+	unsigned int GetIndex(const unsigned long multiplicity) const
+	{
+		const int index = table.GetStrategyIndex(multiplicity);
+		return (index < 0) ? FastJetStrategyTable::nstrategies : index;
+	}
+
+	void AddTime(const unsigned long multiplicity, const unsigned int index, const double time)
+	{
+		time_profile.Fill(multiplicity, time*1e6);
+		nevents[index]++;
+		total_time += time;
+	}
+};
+
+//histograms of partons and jets filled with all event weights
+struct HistSet
+{
+	//partons multiplicity vs pt
+	MultiWeightHist part_pt;
+	//pair of partons multiplicity vs delta y
+	MultiWeightHist part_dy;
+	//jets multiplicity vs pt
+	MultiWeightHist jet_pt;
+	//pair of jets multiplicity vs delta y
+	MultiWeightHist jet_dy;
+
+	HistSet() {};
+
+	//suffix is appended to the names of the histograms; delta y range is [0, dy_max]
+	HistSet(const int nweights, const std::string &suffix = "", const double dy_max = 10.)
+	{
+		part_pt = MultiWeightHist("part_mult_pt" + suffix, "dsigma/dpt", 200, 0., 200., nweights);
+		part_dy = MultiWeightHist("part_mult_dy" + suffix, "dsigma/ddy", 200, 0., dy_max, nweights);
+		jet_pt = MultiWeightHist("jet_mult_pt" + suffix, "dsigma/dpt", 200, 0., 200., nweights);
+		jet_dy = MultiWeightHist("jet_mult_dy" + suffix, "dsigma/ddy", 200, 0., dy_max, nweights);
+	}
+
+	void Add(const HistSet &hists, const double scale = 1.)
+	{
+		part_pt.Add(hists.part_pt, scale);
+		part_dy.Add(hists.part_dy, scale);
+		jet_pt.Add(hists.jet_pt, scale);
+		jet_dy.Add(hists.jet_dy, scale);
+	}
+
+	//histogram by the name of its cross section; nullptr if there is no such histogram
+	const MultiWeightHist *GetHist(const std::string &dsigma_name) const
+	{
+		if (dsigma_name == "part_dsigma_dpt") return &part_pt;
+		if (dsigma_name == "part_dsigma_ddy") return &part_dy;
+		if (dsigma_name == "jet_dsigma_dpt") return &jet_pt;
+		if (dsigma_name == "jet_dsigma_ddy") return &jet_dy;
+		return nullptr;
+	}
+};
+
+//nominal acceptance followed by the additional ones
+std::vector<CutSet> GetCutSetList()
+{
+	std::vector<CutSet> cut_sets = {{Par.ptmin, Par.abs_max_y}};
+	cut_sets.insert(cut_sets.end(), Par.cut_sets.begin(), Par.cut_sets.end());
+	return cut_sets;
 }
 
+//cuts of all cut sets evaluated at once
+const CutSets &GetCutSets()
+{
+	static const CutSets cut_sets = []
+	{
+		CutSets result;
+		for (const CutSet &cut_set : GetCutSetList())
+		{
+			if (!result.Add(cut_set.ptmin, cut_set.abs_max_y)) PrintError("Too many cut sets");
+		}
+		return result;
+	}();
+	return cut_sets;
+}
+
+//histograms of every cut set; the histograms of the nominal one keep their names
+//delta y range covers the widest acceptance
+std::vector<HistSet> MakeHistSets(const int nweights)
+{
+	const double dy_max = static_cast<double>(ceil(GetCutSets().GetMaxAbsMaxY()*2.));
+	std::vector<HistSet> hists;
+	for (const CutSet &cut_set : GetCutSetList())
+	{
+		const std::string suffix = (hists.size() == 0) ? "" : CutSets::GetSuffix(cut_set.ptmin, cut_set.abs_max_y);
+		hists.push_back(HistSet(nweights, suffix, dy_max));
+	}
+	return hists;
+}
+
+void AddHistSets(std::vector<HistSet> &sum, const std::vector<HistSet> &hists, const double scale = 1.)
+{
+	for (unsigned long c = 0; c < sum.size(); c++) sum[c].Add(hists[c], scale);
+}
+
+//random numbers engine of pythia that takes the numbers from the Philox stream set before every event
+//so (seed, slice, event) is the 128-bit counter of the generator instead of the 32-bit pythia seed
+class PhiloxEngine : public RndmEngine
+{
+	private:
+	RandomStream rand = RandomStream(0);
+
+	public :
+
+	void SetStream(const uint64_t seed, const uint64_t stream) {rand = RandomStream(seed, stream);}
+
+	//pythia expects the numbers in (0, 1)
+	double flat() override
+	{
+		double value;
+		do value = rand.Uniform();
+		while (value == 0.);
+		return value;
+	}
+};
+
+//generator of the pT-hat slice; with the precision targets the slices are generated in rounds 
+//in any order so every slice keeps its own initialized pythia and histograms
+struct SliceGenerator
+{
+	std::unique_ptr<Pythia> pythia;
+	std::shared_ptr<PhiloxEngine> rndm_engine = std::make_shared<PhiloxEngine>();
+	//histograms of every cut set; the precision targets are applied to the nominal one
+	std::vector<HistSet> hists;
+	long nevents = 0;
+
+	//cross section per unit of weight; with weighted events (bias2Selection) the cross section 
+	//is distributed over the sum of weights instead of the number of accepted events
+	double GetNorm() const
+	{
+		if (pythia->info.weightSum() <= 0.) return 0.;
+		return pythia->info.sigmaGen()*1e9/pythia->info.weightSum();
+	}
+};
+
 void PrintParameters(unsigned int seed)
 {
 	Box box("Parameters");
 	box.AddEntry("CM beams energy, TeV", Par.energy/1e3, 3);
 	box.AddEntry("PDF set", Par.pdf_set);
+	box.AddEntry("Profile", Par.profile);
+	box.AddEntry("Jets clustering", Par.do_jets);
+	box.AddEntry("Write ntuple", Par.write_ntuple);
 	box.AddEntry("Minimum pT, GeV", Par.ptmin, 3);
 	box.AddEntry("|ymax|", Par.abs_max_y, 3);
-	box.AddEntry("seed", seed);
+	box.AddEntry("Number of additional cut sets", static_cast<int>(Par.cut_sets.size()));
+	box.AddEntry("Number of pT-hat slices", static_cast<int>(Par.slices.size()));
+	box.AddEntry("bias2Selection", Par.bias2_selection);
+	box.AddEntry("Number of precision targets", static_cast<int>(Par.precision_targets.size()));
+	box.AddEntry("Number of weight variations", static_cast<int>(Par.weight_variations.size()));
+	box.AddEntry("seed", static_cast<unsigned long>(seed));
 	box.Print();
 }
 
+void PrintUsage()
+{
+	std::cout << "Usage: ./generate.exe [profile] [options]" << std::endl;
+	std::cout << "Options:" << std::endl;
+	std::cout << " -n nevents    number of events in every pT-hat slice" << std::endl;
+	std::cout << " -p pdfset     pythia PDF set; shm:/dijetxs_<set>[/member] for the shared one" << std::endl;
+	std::cout << " -s seed       seed of the random streams (default from the current time)" << std::endl;
+	std::cout << " -o dir        output directory (default " << Par.output_dir << ")" << std::endl;
+	std::cout << " --target hist:xmin:xmax:error  generate until the relative errors of the bins of the histogram" << std::endl;
+	std::cout << "               (e.g. jet_dsigma_dpt:25:150:0.02) are below the error; can be repeated" << std::endl;
+	std::cout << " --cuts ptmin:ymax  also fill the histograms for pT > ptmin, |y| < ymax; can be repeated" << std::endl;
+	std::cout << " --max-events n  maximum total number of events with the targets (default " << Par.max_nevents << ")" << std::endl;
+	std::cout << " --max-time t    maximum wall time in seconds with the targets (default no limit)" << std::endl;
+	std::cout << " --stats file  write the wall time, peak memory, and number of events" << std::endl;
+	std::cout << " --no-init-cache  do not read or write the cached initialization" << std::endl;
+	std::cout << " --calibrate-fastjet  measure the clustering times of the strategies and write the table" << std::endl;
+}
+
+//target in the form hist:xmin:xmax:error
+PrecisionTarget ReadTarget(const std::string &value)
+{
+	std::vector<std::string> fields;
+	std::stringstream stream(value);
+	for (std::string field; std::getline(stream, field, ':');) fields.push_back(field);
+	if (fields.size() != 4) PrintError("Precision target " + value + " is not of the form hist:xmin:xmax:error");
+	return {fields[0], std::stod(fields[1]), std::stod(fields[2]), std::stod(fields[3])};
+}
+
+void ReadArguments(int argc, char **argv)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		if (arg == "-h" || arg == "--help")
+		{
+			PrintUsage();
+			exit(0);
+		}
+		if (arg == "--no-init-cache")
+		{
+			Par.use_init_cache = false;
+			continue;
+		}
+		if (arg == "--calibrate-fastjet")
+		{
+			Par.calibrate_fastjet = true;
+			continue;
+		}
+		if (arg[0] != '-')
+		{
+			Par.profile = arg;
+			continue;
+		}
+		if (i + 1 >= argc) PrintError("Option " + arg + " requires a value");
+		const std::string value = argv[++i];
+		if (arg == "-n") 
+		{
+			for (PtHatSlice &slice : Par.slices) slice.nevents = std::stod(value);
+		}
+		else if (arg == "-p") 
+		{
+			Par.pdf_set = value;
+			Par.is_pdf_set_passed = true;
+		}
+		else if (arg == "-s") Par.seed = std::stoul(value);
+		else if (arg == "-o") Par.output_dir = value;
+		else if (arg == "--stats") Par.stats_file_name = value;
+		else if (arg == "--target") Par.precision_targets.push_back(ReadTarget(value));
+		else if (arg == "--cuts")
+		{
+			const unsigned long colon = value.find(':');
+			if (colon == std::string::npos) PrintError("Cut set " + value + " is not of the form ptmin:ymax");
+			Par.cut_sets.push_back({std::stod(value.substr(0, colon)), std::stod(value.substr(colon + 1))});
+		}
+		else if (arg == "--max-events") Par.max_nevents = std::stod(value);
+		else if (arg == "--max-time") Par.max_time = std::stod(value);
+		else PrintError("Unknown option " + arg);
+	}
+}
+
+void CheckSlices()
+{
+	if (Par.slices.size() == 0) PrintError("No pT-hat slices were specified");
+	for (unsigned long i = 0; i < Par.slices.size(); i++)
+	{
+		const PtHatSlice &slice = Par.slices[i];
+		if (slice.pthat_max >= 0. && slice.pthat_max <= slice.pthat_min) 
+		{
+			PrintError("pT-hat slice " + std::to_string(i) + " has pthat_max <= pthat_min");
+		}
+		if (i + 1 < Par.slices.size() && slice.pthat_max != Par.slices[i + 1].pthat_min)
+		{
+			PrintError("pT-hat slices " + std::to_string(i) + " and " + std::to_string(i + 1) + 
+				" are not adjacent: they must not overlap or leave gaps");
+		}
+	}
+}
+
+//range of the nominal histogram of the target that can have entries: pT of the hard partons 
+//is within the pT-hat range of the slices, pT of the jets is above ptmin, and delta y is below 2|ymax|
+void GetAcceptance(const std::string &dsigma_name, double &xmin, double &xmax)
+{
+	const MultiWeightHist *hist = HistSet(1, "", ceil(GetCutSets().GetMaxAbsMaxY()*2.)).GetHist(dsigma_name);
+	xmin = hist->GetXmin();
+	xmax = hist->GetXmax();
+
+	if (dsigma_name == "part_dsigma_dpt")
+	{
+		xmin = std::max(xmin, Par.slices.front().pthat_min);
+		if (Par.slices.back().pthat_max >= 0.) xmax = std::min(xmax, Par.slices.back().pthat_max);
+	}
+	else if (dsigma_name == "jet_dsigma_dpt") xmin = std::max(xmin, Par.ptmin);
+	else xmax = std::min(xmax, 2.*Par.abs_max_y);
+}
+
+//the target ranges are clipped to the acceptance since the bins outside of it stay empty
+//and would never reach the target; the targets entirely outside of the acceptance are rejected
+void CheckTargets()
+{
+	for (PrecisionTarget &target : Par.precision_targets)
+	{
+		if (HistSet(1).GetHist(target.hist) == nullptr) PrintError("Unknown histogram " + target.hist + " of the precision target");
+		if (!Par.do_jets && target.hist.compare(0, 4, "jet_") == 0)
+		{
+			PrintError("Precision target " + target.hist + " requires jets but the profile has no hadronization");
+		}
+		if (target.xmax < target.xmin || target.rel_error <= 0.)
+		{
+			PrintError("Precision target " + target.hist + " has xmax < xmin or non-positive error");
+		}
+
+		double xmin, xmax;
+		GetAcceptance(target.hist, xmin, xmax);
+		if (target.xmax <= xmin || target.xmin >= xmax)
+		{
+			PrintError("Precision target " + target.hist + " [" + DtoStr(target.xmin, 1) + ", " + 
+				DtoStr(target.xmax, 1) + "] is outside of the acceptance [" + DtoStr(xmin, 1) + ", " + DtoStr(xmax, 1) + "]");
+		}
+		if (target.xmin < xmin || target.xmax > xmax)
+		{
+			PrintWarning("Precision target " + target.hist + " [" + DtoStr(target.xmin, 1) + ", " + 
+				DtoStr(target.xmax, 1) + "] is clipped to the acceptance [" + DtoStr(xmin, 1) + ", " + DtoStr(xmax, 1) + "]");
+			target.xmin = std::max(target.xmin, xmin);
+			target.xmax = std::min(target.xmax, xmax);
+		}
+	}
+	if (Par.precision_targets.size() > 0 && Par.nevents_per_round < 1.) PrintError("nevents_per_round must be at least 1");
+}
+
 bool IsExcludedPart(int id)
 {
 	id = abs(id);
@@ -71,154 +570,763 @@ bool IsParton(int id)
 	return false;
 }
 
-int main()
+//writes raw histograms and cross sections normalized to the bin width for every weight
+//weight with index 0 is nominal and keeps the name of the histogram; variations get the suffix _w<index>
+//dsigma must be already normalized to the cross section
+void WriteHists(Pythia &pythia, const MultiWeightHist &raw, const MultiWeightHist &dsigma, std::string dsigma_name)
 {
-	Pythia pythia;
-	unsigned int seed = GetRandomSeed();
+	for (int i = 0; i < raw.GetNweights(); i++)
+	{
+		std::string suffix = "";
+		std::string title_suffix = "";
+		if (i > 0) 
+		{
+			suffix = "_w" + std::to_string(i);
+			title_suffix = " " + pythia.info.weightNameByIndex(i);
+		}
+
+		TH1D raw_hist = raw.GetTH1D(i, suffix, title_suffix);
+		TH1D dsigma_hist = dsigma.GetTH1D(i, suffix, title_suffix);
+		dsigma_hist.SetName((dsigma_name + suffix).c_str());
+		dsigma_hist.Scale(1./dsigma.GetBinWidth());
+
+		raw_hist.Write();
+		dsigma_hist.Write();
+	}
+}
+
+//sets pT, y, phi, and m of the object into 4 columns of the ntuple row starting from the given one
+void SetNtupleObject(std::vector<float> &row, const int first_column, 
+	const double pt, const double y, const double phi, const double m)
+{
+	row[first_column] = pt;
+	row[first_column + 1] = y;
+	row[first_column + 2] = phi;
+	row[first_column + 3] = m;
+}
+
+//columns of the ntuple: slice index, 2 leading partons, number of jets and 2 leading jets, weights
+//the layout must be the same as in ProcessEvent
+std::vector<std::string> GetNtupleColumns(const int nweights)
+{
+	std::vector<std::string> columns = {"slice"};
+	std::vector<std::string> objects = {"part1", "part2"};
+	if (Par.do_jets) objects.insert(objects.end(), {"jet1", "jet2"});
+
+	for (std::string object : objects)
+	{
+		if (object == "jet1") columns.push_back("njets");
+		for (std::string var : {"pt", "y", "phi", "m"}) columns.push_back(object + "_" + var);
+	}
+	for (int i = 0; i < nweights; i++) columns.push_back("weight" + std::to_string(i));
+	return columns;
+}
+
+//fills pT of the objects and delta y of their pairs into the histograms of every cut set
+//pT is filled for the objects in |ymax| (and above ptmin if ptmin_for_pt) and the pairs are formed
+//from the objects in |ymax| above ptmin; the acceptances of every object are evaluated for all cut sets
+//at once as bit masks so the pairs are checked for all cut sets by one operation
+void FillObjects(const std::vector<double> &pt, const std::vector<double> &y, const bool ptmin_for_pt,
+	std::vector<HistSet> &hists, MultiWeightHist HistSet::*pt_hist, MultiWeightHist HistSet::*dy_hist,
+	const std::vector<double> &weights)
+{
+	const CutSets &cut_sets = GetCutSets();
+	const unsigned long n = pt.size();
+
+	std::vector<uint64_t> pt_mask(n), pair_mask(n);
+	for (unsigned long j = 0; j < n; j++)
+	{
+		pair_mask[j] = cut_sets.GetYMask(y[j]) & cut_sets.GetPtMask(pt[j]);
+		pt_mask[j] = ptmin_for_pt ? pair_mask[j] : cut_sets.GetYMask(y[j]);
+	}
+
+	for (unsigned long j = 0; j < n; j++)
+	{
+		for (uint64_t mask = pt_mask[j]; mask; mask &= mask - 1)
+		{
+			(hists[CutSets::GetFirst(mask)].*pt_hist).Fill(pt[j], weights);
+		}
+		if (pair_mask[j] == 0) continue;
+
+		for (unsigned long k = j + 1; k < n; k++)
+		{
+			const uint64_t mask = pair_mask[j] & pair_mask[k];
+			if (mask == 0) continue;
+
+			const double delta_y = fabs(y[j] - y[k]);
+			for (uint64_t set_mask = mask; set_mask; set_mask &= set_mask - 1)
+			{
+				(hists[CutSets::GetFirst(set_mask)].*dy_hist).Fill(delta_y, weights);
+			}
+		}
+	}
+}
+
+//fills pT of the hard process partons and delta y of their pairs from the given record;
+//outgoing partons of the hard process have status 23 in pythia.process and -23 in pythia.event
+//if row is passed the first two partons are also set into the ntuple row
+void FillPartons(const Event &record, const int status, std::vector<HistSet> &hists, 
+	const std::vector<double> &weights, std::vector<float> *row = nullptr)
+{
+	std::vector<double> pt, y;
+	for (int j = 0; j < record.size(); j++)
+	{
+		if (record[j].status() != status) continue;
+		if (!IsParton(record[j].id())) continue;
+
+		if (row && pt.size() < 2)
+		{
+			SetNtupleObject(*row, 1 + 4*pt.size(), record[j].pT(), 
+				record[j].y(), record[j].phi(), record[j].m());
+		}
+		pt.push_back(record[j].pT());
+		y.push_back(record[j].y());
+	}
+	FillObjects(pt, y, false, hists, &HistSet::part_pt, &HistSet::part_dy, weights);
+}
+
+//final state particles of the current event
+void SetJetInput(Pythia &pythia, std::vector<fastjet::PseudoJet> &input)
+{
+	input.clear();
+	for (int j = 0; j < pythia.event.size(); j++)
+	{
+		if (!pythia.event[j].isFinal()) continue;
+		input.push_back(fastjet::PseudoJet(
+			pythia.event[j].px(), 
+			pythia.event[j].py(), 
+			pythia.event[j].pz(), 
+			pythia.event[j].e()));
+	}
+}
+
+//fills jets clustered from the final state particles of the current event
+//with the strategy chosen by the number of particles
+//jets are clustered above the lowest ptmin of the cut sets and their pT is filled above ptmin of every set
+//if row is passed the number of jets and the two leading jets above the nominal ptmin 
+//are also set into the ntuple row
+void FillJets(Pythia &pythia, JetClustering &clustering, 
+	std::vector<HistSet> &hists, const std::vector<double> &weights, std::vector<float> *row = nullptr)
+{
+	FastJetVector fjv;
+	SetJetInput(pythia, fjv.input);
+
+	const unsigned int index = clustering.GetIndex(fjv.input.size());
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	fastjet::ClusterSequence cluster_seq(fjv.input, clustering.jet_defs[index]);
+	fjv.inclusive = cluster_seq.inclusive_jets(GetCutSets().GetMinPtmin());
+	clustering.AddTime(fjv.input.size(), index, 
+		std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+	if (row)
+	{
+		std::vector<fastjet::PseudoJet> sorted_jets = fastjet::sorted_by_pt(fjv.inclusive);
+		while (sorted_jets.size() > 0 && sorted_jets.back().pt() < Par.ptmin) sorted_jets.pop_back();
+
+		(*row)[9] = sorted_jets.size();
+		for (int j = 0; j < 2; j++)
+		{
+			if (j < sorted_jets.size()) 
+			{
+				SetNtupleObject(*row, 10 + 4*j, sorted_jets[j].pt(), 
+					sorted_jets[j].rap(), sorted_jets[j].phi_std(), sorted_jets[j].m());
+			}
+			else SetNtupleObject(*row, 10 + 4*j, 0., 0., 0., 0.);
+		}
+	}
 	
-	//setting pythia parameters
+	std::vector<double> pt(fjv.inclusive.size()), y(fjv.inclusive.size());
+	for (unsigned long j = 0; j < fjv.inclusive.size(); j++)
+	{
+		pt[j] = fjv.inclusive[j].pt();
+		y[j] = fjv.inclusive[j].rap();
+	}
+	FillObjects(pt, y, true, hists, &HistSet::jet_pt, &HistSet::jet_dy, weights);
+}
+
+//fills partons and jets from the current event
+//for parton level profiles only the hard process record is read
+//if ntuple is passed the event is also written into it
+void ProcessEvent(Pythia &pythia, JetClustering &clustering, 
+	std::vector<HistSet> &hists, const std::vector<double> &weights, const int slice, 
+	AsyncNtupleWriter *ntuple = nullptr)
+{
+	std::vector<float> row;
+	if (ntuple) 
+	{
+		row.resize(ntuple->GetNcolumns());
+		row[0] = slice;
+		for (unsigned long i = 0; i < weights.size(); i++) 
+		{
+			row[row.size() - weights.size() + i] = weights[i];
+		}
+	}
+	std::vector<float> *row_ptr = ntuple ? &row : nullptr;
+
+	if (!Par.do_jets) FillPartons(pythia.process, 23, hists, weights, row_ptr);
+	else
+	{
+		FillPartons(pythia.event, -23, hists, weights, row_ptr);
+		FillJets(pythia, clustering, hists, weights, row_ptr);
+	}
+
+	if (ntuple) ntuple->Fill(row);
+}
+
+//determines which stages of the generation are needed for the given profile
+void SetStages(Pythia &pythia)
+{
+	//without hadronization there are no jets to cluster 
+	//and only the partons of the hard process are analyzed
+	Par.do_jets = pythia.flag("HadronLevel:all");
+	
+	//the showers and MPI do not change the hard process record so they are switched off
+	if (!Par.do_jets) pythia.readString("PartonLevel:all = off");
+
+	//without the showers the shower variations are identically 1 so their histograms would be 
+	//copies of the nominal ones
+	if (!pythia.flag("PartonLevel:all") || (!pythia.flag("PartonLevel:ISR") && !pythia.flag("PartonLevel:FSR")))
+	{
+		Par.weight_variations.clear();
+	}
+}
+
+//returns the name of the profile file without the directory and the extension
+std::string GetProfileName(std::string profile)
+{
+	profile = profile.substr(profile.find_last_of("/") + 1);
+	return profile.substr(0, profile.find_last_of("."));
+}
+
+//calls the function for every bin of the target with the stitched cross section (up to the bin width) 
+//and the contributions of the slices to its squared error
+void ForEachTargetBin(const std::vector<SliceGenerator> &generators, const PrecisionTarget &target,
+	std::function<void(double, const std::vector<double> &)> function)
+{
+	const MultiWeightHist *first_hist = generators[0].hists[0].GetHist(target.hist);
+	std::vector<double> error2(generators.size());
+
+	for (int bin = 1; bin <= first_hist->GetNbins(); bin++)
+	{
+		const double center = first_hist->GetBinCenter(bin);
+		if (center < target.xmin || center > target.xmax) continue;
+
+		double value = 0.;
+		for (unsigned long i = 0; i < generators.size(); i++)
+		{
+			const MultiWeightHist *hist = generators[i].hists[0].GetHist(target.hist);
+			const double norm = generators[i].GetNorm();
+			value += norm*hist->GetBinContent(bin);
+			error2[i] = pow(norm*hist->GetBinError(bin), 2);
+		}
+		function(value, error2);
+	}
+}
+
+//largest relative error of the stitched cross section over the bins of the target;
+//the error of the bins without entries is infinite (the target ranges are within the acceptance 
+//so these bins are only not filled yet)
+double GetRelError(const std::vector<SliceGenerator> &generators, const PrecisionTarget &target)
+{
+	double max_rel_error = 0.;
+	ForEachTargetBin(generators, target, [&](const double value, const std::vector<double> &error2)
+	{
+		if (value <= 0.) max_rel_error = std::numeric_limits<double>::infinity();
+		else
+		{
+			double sum_error2 = 0.;
+			for (const double slice_error2 : error2) sum_error2 += slice_error2;
+			max_rel_error = std::max(max_rel_error, sqrt(sum_error2)/value);
+		}
+	});
+	return max_rel_error;
+}
+
+bool AreTargetsReached(const std::vector<SliceGenerator> &generators)
+{
+	for (const PrecisionTarget &target : Par.precision_targets)
+	{
+		if (GetRelError(generators, target) > target.rel_error) return false;
+	}
+	return true;
+}
+
+//slice whose next round reduces the errors of the unreached bins the most: the squared error 
+//contributed by the slice decreases as 1/nevents so the gain per event is the contribution
+//divided by the number of events of the slice and by the target squared error of the bin
+//if no slice contributes to the unreached bins (e.g. they have no entries yet) 
+//the slice with the least number of events is taken
+unsigned long ChooseSlice(const std::vector<SliceGenerator> &generators)
+{
+	std::vector<double> gain(generators.size(), 0.);
+	for (const PrecisionTarget &target : Par.precision_targets)
+	{
+		ForEachTargetBin(generators, target, [&](const double value, const std::vector<double> &error2)
+		{
+			if (value <= 0.) return;
+			double sum_error2 = 0.;
+			for (const double slice_error2 : error2) sum_error2 += slice_error2;
+			if (sqrt(sum_error2) <= target.rel_error*value) return;
+
+			for (unsigned long i = 0; i < generators.size(); i++)
+			{
+				gain[i] += error2[i]/(static_cast<double>(generators[i].nevents)*pow(target.rel_error*value, 2));
+			}
+		});
+	}
+
+	unsigned long best = 0;
+	for (unsigned long i = 1; i < generators.size(); i++)
+	{
+		if (gain[i] > gain[best] || (gain[best] == 0. && generators[i].nevents < generators[best].nevents)) best = i;
+	}
+	return best;
+}
+
+//reached and unreached targets with their errors and the number of events of every slice
+void PrintTargets(const std::vector<SliceGenerator> &generators, const std::string &stop_reason)
+{
+	Box box("Precision targets");
+	int nreached = 0;
+	for (const PrecisionTarget &target : Par.precision_targets)
+	{
+		const double rel_error = GetRelError(generators, target);
+		const bool is_reached = rel_error <= target.rel_error;
+		if (is_reached) nreached++;
+
+		box.AddEntry(target.hist + " [" + DtoStr(target.xmin, 1) + ", " + DtoStr(target.xmax, 1) + "] " + 
+			DtoStr(target.rel_error*100., 2) + "%", (is_reached ? "reached " : "NOT reached ") + 
+			(std::isinf(rel_error) ? std::string("empty bins") : DtoStr(rel_error*100., 2) + "%"));
+	}
+	box.AddEntry("Targets reached", std::to_string(nreached) + "/" + std::to_string(Par.precision_targets.size()));
+	box.AddEntry("Stopped", stop_reason);
+	for (unsigned long i = 0; i < generators.size(); i++)
+	{
+		box.AddEntry("Events in slice " + std::to_string(i), static_cast<unsigned long>(generators[i].nevents));
+	}
+	box.Print();
+}
+
+//key of the initialization: pythia version, energy, PDF set, and profile
+std::string GetInitKey(Pythia &pythia)
+{
+	std::ifstream profile(Par.profile);
+	std::stringstream profile_contents;
+	profile_contents << profile.rdbuf();
+
+	//the shared set is identified by the set and member stored in the segment and by its grid
+	//rather than by the name of the segment
+	unsigned int member;
+	std::string pdf_set = Par.is_pdf_set_passed ? Par.pdf_set : pythia.word("PDF:pSet");
+	if (std::shared_ptr<const SharedPDF::Segment> segment = GetSharedSegment(member))
+	{
+		pdf_set = "shm " + segment->GetPDFSetName() + "/" + std::to_string(member) + " " + 
+			std::to_string(segment->GetNx()) + "x" + std::to_string(segment->GetNq2());
+	}
+
+	return std::to_string(pythia.parm("Pythia:versionNumber")) + " " + std::to_string(Par.energy) + " " + 
+		pdf_set + " " + profile_contents.str();
+}
+
+//MPI initialization samples its tables with the random generator so pythia is initialized with the seed
+//derived from the key independently of the run seed; every event has its own stream anyway so the runs
+//with the same seed give the same histograms with or without the cache and all runs share the cache
+uint64_t GetInitSeed(Pythia &pythia)
+{
+	return HashStr(GetInitKey(pythia));
+}
+
+//name of the cache file of the initialization: hash of the key of the initialization
+std::string GetInitCacheFileName(Pythia &pythia)
+{
+	std::stringstream file_name;
+	file_name << Par.cache_dir << "/mpi_init_" << std::hex << HashStr(GetInitKey(pythia)) << ".dat";
+	return file_name.str();
+}
+
+//initialization of multiparton interactions is the longest part of pythia.init() for the profiles with MPI
+//and does not depend on the pT-hat range; it is read from the cache file if it exists or is written
+//into the temporary file that is renamed into the cache file by FinishInitCache
+//so the concurrent jobs never read a partially written file
+//returns the name of the temporary file or "" if nothing is written
+std::string SetInitCache(Pythia &pythia)
+{
+	if (!Par.use_init_cache || !pythia.flag("PartonLevel:all") || !pythia.flag("PartonLevel:MPI")) return "";
+
+	const std::string cache_file_name = GetInitCacheFileName(pythia);
+	if (std::ifstream(cache_file_name).good())
+	{
+		pythia.readString("MultipartonInteractions:reuseInit = 1");
+		pythia.readString("MultipartonInteractions:initFile = " + cache_file_name);
+		return "";
+	}
+
+	system(("mkdir -p " + Par.cache_dir).c_str());
+	const std::string temp_file_name = cache_file_name + "." + std::to_string(getpid());
+	pythia.readString("MultipartonInteractions:reuseInit = 2");
+	pythia.readString("MultipartonInteractions:initFile = " + temp_file_name);
+	return temp_file_name;
+}
+
+void FinishInitCache(Pythia &pythia, const std::string &temp_file_name)
+{
+	if (temp_file_name == "") return;
+	if (rename(temp_file_name.c_str(), GetInitCacheFileName(pythia).c_str()) != 0)
+	{
+		PrintWarning("Initialization cache " + temp_file_name + " cannot be renamed");
+	}
+}
+
+//common settings of all slices; settings from the profile override the default ones
+void SetPythiaParameters(Pythia &pythia, const bool is_shared_pdf)
+{
 	pythia.readString("Beams:eCM = " + to_string(Par.energy));
 	pythia.readString("HardQCD:all = on");
-	pythia.readString("PDF:pSet = " + Par.pdf_set);
-	pythia.readString("PhaseSpace::pTHatMin = " + to_string(Par.ptmin));
+	//the PDF from the shared memory is passed to pythia directly in SetSharedPDF
+	if (!is_shared_pdf) pythia.readString("PDF:pSet = " + Par.pdf_set);
 	
-	pythia.readString("Random:setSeed = on");
-	pythia.readString("Random:seed = " + to_string(seed));
 	pythia.readString("Print:quiet = on");
-	
-	//creating a structure of vectors for fastjet
-	
-	//setting fastjet parameters
-	fastjet::JetDefinition jet_def(fastjet::antikt_algorithm, Par.fastjet_r_par, Par.strategy);
 
-	//initializing pythia
-	pythia.init();
+	pythia.readFile(Par.profile);
+	if (Par.is_pdf_set_passed && !is_shared_pdf) pythia.readString("PDF:pSet = " + Par.pdf_set);
+	SetSharedPDF(pythia);
+	SetStages(pythia);
+
+	if (Par.weight_variations.size() > 0)
+	{
+		std::string variations_list = "";
+		for (std::string variation : Par.weight_variations)
+		{
+			if (variations_list != "") variations_list += ", ";
+			variations_list += variation;
+		}
+		pythia.readString("UncertaintyBands:doVariations = on");
+		pythia.readString("UncertaintyBands:List = {" + variations_list + "}");
+	}
+
+	if (Par.bias2_selection)
+	{
+		pythia.readString("PhaseSpace:bias2Selection = on");
+		pythia.readString("PhaseSpace:bias2SelectionPow = " + to_string(Par.bias2_selection_pow));
+	}
+}
+
+//generates nevents next events of the slice; event j of slice i uses the random stream (seed, i, j)
+//so the events are the same independently of the order in which the slices are generated
+void GenerateEvents(SliceGenerator &generator, const unsigned long slice, const long nevents, 
+	const unsigned int seed, JetClustering &clustering, AsyncNtupleWriter *ntuple, 
+	ProgressBar &pbar, const double nevents_done, const double nevents_total)
+{
+	Pythia &pythia = *generator.pythia;
+
+	//nominal weight and all variations
+	const int nweights = pythia.info.numberOfWeights();
+	std::vector<double> weights(nweights);
+
+	for (long j = generator.nevents; j < generator.nevents + nevents; j++)
+	{
+		pbar.Print((nevents_done + static_cast<double>(j - generator.nevents))/nevents_total);
+		generator.rndm_engine->SetStream(seed, (static_cast<uint64_t>(slice) << 32) | j);
+		if (!pythia.next()) continue;
+		
+		for (int k = 0; k < nweights; k++) weights[k] = pythia.info.weightValueByIndex(k);
+		ProcessEvent(pythia, clustering, generator.hists, weights, slice, ntuple);
+	}
+	generator.nevents += nevents;
+}
+
+//times the clustering of calibration_nevents events of the first slice with every candidate strategy
+//in the multiplicity bins of the events and writes the mean times into the table in cache_dir
+void CalibrateFastJet(SliceGenerator &generator, const unsigned int seed, const JetClustering &clustering)
+{
+	Pythia &pythia = *generator.pythia;
+
+	FastJetStrategyTable table = clustering.table;
+	const unsigned int nstrategies = FastJetStrategyTable::nstrategies;
+
+	//sums of the mean times of the events and the number of events in every bin
+	std::vector<std::array<double, nstrategies>> sum_time;
+	std::vector<double> nevents;
+
+	ProgressBar pbar("FANCY");
+	pbar.SetText("Calibration");
+
+	std::vector<fastjet::PseudoJet> input;
+	for (long j = 0; j < Par.calibration_nevents; j++)
+	{
+		pbar.Print(static_cast<double>(j)/Par.calibration_nevents);
+		generator.rndm_engine->SetStream(seed, j);
+		if (!pythia.next()) continue;
+		SetJetInput(pythia, input);
+
+		const unsigned int bin = FastJetStrategyTable::GetBin(input.size());
+		if (bin >= nevents.size())
+		{
+			sum_time.resize(bin + 1, std::array<double, nstrategies>{});
+			nevents.resize(bin + 1, 0.);
+		}
+		for (unsigned int s = 0; s < nstrategies; s++)
+		{
+			const double time = FastJetStrategyTable::MeasureTime(input, clustering.jet_defs[s], 
+				GetCutSets().GetMinPtmin(), Par.calibration_min_time);
+			//one failure marks the strategy as not available in the bin
+			if (time < 0. || sum_time[bin][s] < 0.) sum_time[bin][s] = -1.;
+			else sum_time[bin][s] += time;
+		}
+		nevents[bin]++;
+	}
+	pbar.Print(1);
+
+	Box box("FastJet calibration, us per event");
+	for (unsigned int bin = 0; bin < nevents.size(); bin++)
+	{
+		if (nevents[bin] == 0.) continue;
+		std::stringstream entry;
+		for (unsigned int s = 0; s < nstrategies; s++)
+		{
+			const double time = (sum_time[bin][s] < 0.) ? -1. : sum_time[bin][s]/nevents[bin];
+			table.SetTime(bin, s, time);
+			entry << FastJetStrategyTable::strategy_names[s] << " " << DtoStr(time, 1) << " ";
+		}
+		box.AddEntry("N >= " + std::to_string(FastJetStrategyTable::GetMinMultiplicity(bin)) + 
+			" (" + std::to_string(static_cast<long>(nevents[bin])) + " events)", entry.str());
+	}
+	box.Print();
+
+	system(("mkdir -p " + Par.cache_dir).c_str());
+	if (!table.Write(GetStrategyTableFileName())) PrintError("File " + GetStrategyTableFileName() + " cannot be created");
+	PrintInfo("File " + GetStrategyTableFileName() + " was written");
+}
+
+void PrintClustering(const JetClustering &clustering)
+{
+	Box box("Jets clustering");
+	unsigned long nevents = 0;
+	for (unsigned int i = 0; i < clustering.jet_defs.size(); i++)
+	{
+		if (clustering.nevents[i] == 0) continue;
+		const std::string name = (i < FastJetStrategyTable::nstrategies) ? 
+			FastJetStrategyTable::strategy_names[i] : "default strategy";
+		box.AddEntry("Events clustered with " + name, clustering.nevents[i]);
+		nevents += clustering.nevents[i];
+	}
+	if (nevents > 0) box.AddEntry("Mean time per event, us", clustering.total_time/nevents*1e6, 1);
+	box.Print();
+}
+
+int main(int argc, char **argv)
+{
+	RunStats stats;
+	ReadArguments(argc, argv);
+
+	const unsigned int seed = (Par.seed == 0) ? GetRandomSeed() : Par.seed;
+	const bool is_shared_pdf = Par.pdf_set.compare(0, 5, "shm:/") == 0;
+	CheckInputFile(Par.profile);
+	CheckSlices();
+
+	//the generators of the other slices are copied from the settings and particle data 
+	//of the first one so the xml database is read only once
+	std::vector<SliceGenerator> generators(Par.slices.size());
+	for (unsigned long i = 0; i < generators.size(); i++)
+	{
+		if (i == 0) generators[i].pythia = std::make_unique<Pythia>();
+		else 
+		{
+			generators[i].pythia = std::make_unique<Pythia>(generators[0].pythia->settings, 
+				generators[0].pythia->particleData, false);
+		}
+		SetPythiaParameters(*generators[i].pythia, is_shared_pdf);
+		generators[i].pythia->setRndmEnginePtr(generators[i].rndm_engine);
+	}
+	CheckTargets();
+	
+	//setting fastjet parameters; the strategy of every event is chosen from the calibration table
+	JetClustering clustering;
+	if (Par.do_jets && !Par.calibrate_fastjet && clustering.table.IsEmpty())
+	{
+		PrintInfo("FastJet calibration table " + GetStrategyTableFileName() + 
+			" was not found; the default strategy is used (run with --calibrate-fastjet)");
+	}
 
 	//creating directory for output
-	system("mkdir ../output");
+	system(("mkdir -p " + Par.output_dir).c_str());
 	
 	//printing parameters info
 	PrintParameters(seed);
 
-	//partons multiplicity vs pt
-	TH1D hist_part_pt = TH1D("part_mult_pt", "dsigma/dpt", 200, 0., 200.);
-	//pair of partons multiplicity vs delta y
-	TH1D hist_part_dy = TH1D("part_mult_dy", "dsigma/ddy", 
-		200, 0., static_cast<double>(ceil(Par.abs_max_y*2.)));
+	//sums over all slices: raw histograms are summed as they are 
+	//and cross sections are normalized in every slice before summation
+	std::vector<HistSet> raw, dsigma;
+	
+	//accepted events, cross section and its squared error summed over slices
+	double naccepted = 0., sigma = 0., sigma_err2 = 0.;
+	TH1D slices_info = TH1D("slices_info", "slice sigma, pb", Par.slices.size(), 0, Par.slices.size());
+	//cross section per unit of weight in every slice; 
+	//the cross section of the ntuple entry is weight*norm[slice]
+	TH1D slices_norm = TH1D("slices_norm", "pb per unit weight", Par.slices.size(), 0, Par.slices.size());
 
-	//jets multiplicity vs pt
-	TH1D hist_jet_pt = TH1D("jet_mult_pt", "dsigma/dpt", 200, 0., 200.);
-	//pair of jets multiplicity vs delta y
-	TH1D hist_jet_dy = TH1D("jet_mult_dy", "dsigma/ddy", 
-		200, 0., static_cast<double>(ceil(Par.abs_max_y*2.)));
+	std::unique_ptr<AsyncNtupleWriter> ntuple;
+	const std::string ntuple_file_name = Par.output_dir + "/ntuple_" + GetProfileName(Par.profile) + ".root";
+
+	const double init_start_time = stats.GetWallTime();
+	for (unsigned long i = 0; i < Par.slices.size(); i++)
+	{
+		Pythia &pythia = *generators[i].pythia;
+		pythia.readString("PhaseSpace:pTHatMin = " + to_string(Par.slices[i].pthat_min));
+		pythia.readString("PhaseSpace:pTHatMax = " + to_string(Par.slices[i].pthat_max));
+		if (Par.bias2_selection) 
+		{
+			pythia.readString("PhaseSpace:bias2SelectionRef = " + to_string(Par.slices[i].pthat_min));
+		}
+
+		//initializing pythia; the slices after the first one read the initialization cache written by it
+		generators[i].rndm_engine->SetStream(GetInitSeed(pythia), 0);
+		const std::string temp_init_file_name = SetInitCache(pythia);
+		pythia.init();
+		FinishInitCache(pythia, temp_init_file_name);
+
+		//nominal weight and all variations
+		const int nweights = pythia.info.numberOfWeights();
+		generators[i].hists = MakeHistSets(nweights);
+		if (i == 0) 
+		{
+			raw = MakeHistSets(nweights);
+			dsigma = MakeHistSets(nweights);
+			
+			if (Par.write_ntuple) 
+			{
+				ntuple = std::make_unique<AsyncNtupleWriter>(ntuple_file_name, 
+					"dijets", GetNtupleColumns(nweights));
+			}
+		}
+	}
+	const double init_time = stats.GetWallTime() - init_start_time;
+
+	if (Par.calibrate_fastjet)
+	{
+		if (!Par.do_jets) PrintError("The profile has no hadronization so there are no jets to cluster");
+		CalibrateFastJet(generators[0], seed, clustering);
+		return 0;
+	}
+
+	double nevents_total = 0., nevents_done = 0.;
 
-	TH1D gen_info = TH1D("gen_info", "info", 2, 0, 2);
-	
 	//progress bar
 	ProgressBar pbar("FANCY");
 
-	//events loop
-	for (long i = 0; i < Par.nevents; i++)
+	if (Par.precision_targets.size() == 0)
 	{
-		if (!pythia.next()) continue;
-		FastJetVector fjv;
-		
-		//particles in event loop
-		for (int j = 0; j < pythia.event.size(); j++)
+		for (const PtHatSlice &slice : Par.slices) nevents_total += slice.nevents;
+		for (unsigned long i = 0; i < Par.slices.size(); i++)
 		{
-			if (!pythia.event[j].isFinal()) 
-			{
-				if (pythia.event[j].status() != -23) continue;
-				if (!IsParton(pythia.event[j].id())) continue;
-				if (abs(pythia.event[j].y()) > Par.abs_max_y) continue;
-				
-				hist_part_pt.Fill(pythia.event[j].pT(), pythia.info.weight());
-				if (pythia.event[j].pT() < Par.ptmin) continue;
-				
-				for (int k = j+1; k < pythia.event.size(); k++)
-				{
-					if (pythia.event[k].status() != -23) continue;
-					if (!IsParton(pythia.event[k].id())) continue;
-					if (pythia.event[k].pT() < Par.ptmin) continue;
-					if (abs(pythia.event[k].y()) > Par.abs_max_y) continue;
-					
-					const double delta_y = abs(pythia.event[j].y() - pythia.event[k].y());
-					hist_part_dy.Fill(delta_y, pythia.info.weight());
-				}
+			GenerateEvents(generators[i], i, Par.slices[i].nevents, seed, clustering, ntuple.get(), 
+				pbar, nevents_done, nevents_total);
+			nevents_done += Par.slices[i].nevents;
+		}
+		pbar.Print(1);
+	}
+	else
+	{
+		//the progress is shown with respect to the budget
+		nevents_total = (Par.max_nevents > 0.) ? Par.max_nevents : 
+			std::numeric_limits<double>::max();
+		const long nevents_per_round = Par.nevents_per_round;
+		auto generate_round = [&](const unsigned long i)
+		{
+			GenerateEvents(generators[i], i, nevents_per_round, seed, clustering, ntuple.get(), 
+				pbar, nevents_done, nevents_total);
+			nevents_done += nevents_per_round;
+		};
+
+		//the first round in every slice gives the first estimates of the errors
+		for (unsigned long i = 0; i < generators.size(); i++) generate_round(i);
 
+		std::string stop_reason = "all targets are reached";
+		while (!AreTargetsReached(generators))
+		{
+			if (Par.max_nevents > 0. && nevents_done + nevents_per_round > Par.max_nevents)
+			{
+				stop_reason = "event budget is spent";
+				break;
 			}
-			else
+			if (Par.max_time > 0. && stats.GetWallTime() >= Par.max_time)
 			{
-				fjv.input.push_back(fastjet::PseudoJet(
-					pythia.event[j].px(), 
-					pythia.event[j].py(), 
-					pythia.event[j].pz(), 
-					pythia.event[j].e()));
+				stop_reason = "time budget is spent";
+				break;
 			}
+			generate_round(ChooseSlice(generators));
 		}
+		pbar.Print(1);
+		PrintTargets(generators, stop_reason);
+		nevents_total = nevents_done;
+	}
+	if (Par.do_jets) PrintClustering(clustering);
 
-		fastjet::ClusterSequence cluster_seq(fjv.input, jet_def);
-		fjv.inclusive = cluster_seq.inclusive_jets(Par.ptmin);
-		
-		pbar.Print(static_cast<double>(i)/Par.nevents);
+	for (unsigned long i = 0; i < Par.slices.size(); i++)
+	{
+		const Pythia &pythia = *generators[i].pythia;
+		const double norm = generators[i].GetNorm();
+		slices_norm.SetBinContent(i + 1, norm);
 		
-		//jets loop
-		for (int j = 0; j < fjv.inclusive.size(); j++)
-		{
-			if (abs(fjv.inclusive[j].rap()) > Par.abs_max_y) continue;
-			hist_jet_pt.Fill(fjv.inclusive[j].pt(), pythia.info.weight());
-			
-			if (fjv.inclusive[j].pt() < Par.ptmin) continue;
-			
-			//loop to form pairs of jets
-			for (int k = j+1; k < fjv.inclusive.size(); k++)
-			{
-				if (fjv.inclusive[k].pt() < Par.ptmin) continue;
-				if (abs(fjv.inclusive[k].rap()) > Par.abs_max_y) continue;
-				
-				const double delta_y = abs(fjv.inclusive[j].rap() - fjv.inclusive[k].rap());
-				hist_jet_dy.Fill(delta_y, pythia.info.weight());
-			}
-		}
+		AddHistSets(raw, generators[i].hists);
+		AddHistSets(dsigma, generators[i].hists, norm);
+
+		naccepted += pythia.info.nAccepted();
+		sigma += pythia.info.sigmaGen()*1e9;
+		sigma_err2 += pow(pythia.info.sigmaErr()*1e9, 2);
+
+		slices_info.SetBinContent(i + 1, pythia.info.sigmaGen()*1e9);
+		slices_info.SetBinError(i + 1, pythia.info.sigmaErr()*1e9);
 	}
-	pbar.Print(1);
 
-	gen_info.SetBinContent(1, pythia.info.nAccepted());
-	gen_info.SetBinContent(2, pythia.info.sigmaGen()*1.e9);
+	TH1D gen_info = TH1D("gen_info", "info", 2, 0, 2);
+	gen_info.SetBinContent(1, naccepted);
+	gen_info.SetBinContent(2, sigma);
+	gen_info.SetBinError(2, sqrt(sigma_err2));
 	
-	std::string output_file_name = "../output/gen.root";
+	std::string output_file_name = Par.output_dir + "/gen_" + GetProfileName(Par.profile) + ".root";
 	TFile output = TFile(output_file_name.c_str(), "RECREATE");
 
-	//cross sections for the quick access in TFile
-	TH1D *hist_part_dsigma_dpt = (TH1D *) hist_part_pt.Clone("part_dsigma_dpt");
-	TH1D *hist_part_dsigma_ddy = (TH1D *) hist_part_dy.Clone("part_dsigma_ddy");
-	TH1D *hist_jet_dsigma_dpt = (TH1D *) hist_jet_pt.Clone("jet_dsigma_dpt");
-	TH1D *hist_jet_dsigma_ddy = (TH1D *) hist_jet_dy.Clone("jet_dsigma_ddy");
-
-	hist_part_dsigma_dpt->Scale(pythia.info.sigmaGen()*1e9/
-		(pythia.info.nAccepted()*hist_part_dsigma_dpt->GetXaxis()->GetBinWidth(1)));
-	hist_part_dsigma_ddy->Scale(pythia.info.sigmaGen()*1e9/
-		(pythia.info.nAccepted()*hist_part_dsigma_ddy->GetXaxis()->GetBinWidth(1)));
-	hist_jet_dsigma_dpt->Scale(pythia.info.sigmaGen()*1e9/
-		(pythia.info.nAccepted()*hist_jet_dsigma_dpt->GetXaxis()->GetBinWidth(1)));
-	hist_jet_dsigma_ddy->Scale(pythia.info.sigmaGen()*1e9/
-		(pythia.info.nAccepted()*hist_jet_dsigma_ddy->GetXaxis()->GetBinWidth(1)));
-	
 	gen_info.Write();
+	slices_info.Write();
+	if (Par.do_jets) clustering.time_profile.Write();
 	
-	hist_part_pt.Write();
-	hist_part_dy.Write();
-	hist_jet_pt.Write();
-	hist_jet_dy.Write();
-	
-	hist_part_dsigma_dpt->Write();
-	hist_part_dsigma_ddy->Write();
-	hist_jet_dsigma_dpt->Write();
-	hist_jet_dsigma_ddy->Write();
+	//cross sections are written for the quick access in TFile
+	const std::vector<CutSet> cut_sets = GetCutSetList();
+	for (unsigned long c = 0; c < cut_sets.size(); c++)
+	{
+		const std::string suffix = (c == 0) ? "" : CutSets::GetSuffix(cut_sets[c].ptmin, cut_sets[c].abs_max_y);
+		Pythia &pythia = *generators[0].pythia;
+		WriteHists(pythia, raw[c].part_pt, dsigma[c].part_pt, "part_dsigma_dpt" + suffix);
+		WriteHists(pythia, raw[c].part_dy, dsigma[c].part_dy, "part_dsigma_ddy" + suffix);
+		if (Par.do_jets)
+		{
+			WriteHists(pythia, raw[c].jet_pt, dsigma[c].jet_pt, "jet_dsigma_dpt" + suffix);
+			WriteHists(pythia, raw[c].jet_dy, dsigma[c].jet_dy, "jet_dsigma_ddy" + suffix);
+		}
+	}
 	
 	output.Close();
 	
 	PrintInfo("File " + output_file_name + " was written");
+
+	if (ntuple)
+	{
+		ntuple->Close();
+		TFile ntuple_file = TFile(ntuple_file_name.c_str(), "UPDATE");
+		slices_norm.Write();
+		ntuple_file.Close();
+		PrintInfo("File " + ntuple_file_name + " was written");
+	}
+
+	if (Par.stats_file_name != "")
+	{
+		stats.Add("init_time", init_time);
+		stats.Add("events", nevents_total);
+		stats.Add("events_per_second", nevents_total/stats.GetWallTime());
+		if (Par.do_jets) stats.Add("clustering_time", clustering.total_time);
+		if (!stats.Write(Par.stats_file_name)) PrintError("File " + Par.stats_file_name + " cannot be created");
+	}
 	
 	return 0;
 }
@@ -0,0 +1,228 @@
+import os
+import sys
+import json
+import shutil
+import argparse
+import subprocess
+import ROOT
+
+ROOT.gROOT.SetBatch(True)
+ROOT.TH1.AddDirectory(False)
+
+#reduced reference configurations with the fixed seeds; every run takes seconds
+#the output directory and the stats file are added to the command by the harness
+#"files" are the output files whose histograms are compared with the reference ones
+#generate.exe runs without the initialization cache so every run (and init_time) starts cold
+#independently of the runs made before it; shared_pdf fails if the PDF set in the shared memory
+#deviates from LHAPDF inside or at the edges of the grid (analytic.exe --check-pdf)
+configurations = [
+    {"name": "analytic",
+        "command": ["./analytic.exe", "-n", "2000", "-b", "20", "-s", "1"],
+        "files": ["analytic.root"]},
+    {"name": "generate_simple",
+        "command": ["./generate.exe", "../input/simple.cmnd", "-n", "5000", "-s", "1", "--no-init-cache"],
+        "files": ["gen_simple.root"]},
+    {"name": "generate_default",
+        "command": ["./generate.exe", "../input/default.cmnd", "-n", "1000", "-s", "1", "--no-init-cache"],
+        "files": ["gen_default.root"]},
+    {"name": "shared_pdf",
+        "command": ["./analytic.exe", "--check-pdf"],
+        "files": []},
+]
+
+#metrics from the stats files and their allowed relative change: "max" metrics must not exceed
+#baseline*(1 + tolerance) and "min" metrics must not fall below baseline*(1 - tolerance)
+tolerances = {
+    "wall_time": ["max", 0.25],
+    "init_time": ["max", 0.25],
+    "peak_memory": ["max", 0.2],
+    "events_per_second": ["min", 0.2],
+    "integrand_calls_per_second": ["min", 0.2],
+}
+
+#histograms are compatible with the reference if the chi2 probability is above this value
+#with the same seed unchanged code gives identical histograms so any physics change
+#larger than the statistical errors fails the test
+min_probability = 1e-3
+
+#baseline.json with the metrics and the reference output files of every configuration
+#baselines depend on the machine so they must be recorded on the machine that runs the tests
+baseline_dir = "../regression"
+output_dir = "../output/regression"
+
+red = "\033[1;31m"
+green = "\033[1;32m"
+reset = "\033[0m"
+
+def read_stats(file_name):
+    stats = {}
+    with open(file_name) as file:
+        for line in file:
+            name, value = line.split()
+            stats[name] = float(value)
+    return stats
+
+#runs the configuration nrepeats times and returns the best value of every metric
+#since the slow runs are usually caused by the other processes on the machine
+def run(configuration, nrepeats):
+    run_dir = os.path.join(output_dir, configuration["name"])
+    stats_file_name = os.path.join(run_dir, "stats.txt")
+    os.makedirs(run_dir, exist_ok=True)
+
+    command = configuration["command"] + ["-o", run_dir, "--stats", stats_file_name]
+    best = {}
+    for i in range(nrepeats):
+        result = subprocess.run(command, stdout=subprocess.DEVNULL)
+        if result.returncode != 0:
+            return None, run_dir
+        for name, value in read_stats(stats_file_name).items():
+            if name not in tolerances or name not in best:
+                best[name] = value
+            elif tolerances[name][0] == "max":
+                best[name] = min(best[name], value)
+            else:
+                best[name] = max(best[name], value)
+    return best, run_dir
+
+#returns the list of failures of the metrics
+def check_metrics(name, stats, baseline):
+    failures = []
+    for metric, (kind, tolerance) in tolerances.items():
+        if metric not in baseline:
+            continue
+        if metric not in stats:
+            failures.append(name + ": " + metric + " is missing")
+            continue
+        change = stats[metric]/baseline[metric] - 1. if baseline[metric] > 0. else 0.
+        is_failed = change > tolerance if kind == "max" else change < -tolerance
+        status = red + "FAIL" + reset if is_failed else green + "ok" + reset
+        print("  %-28s %12.4g %12.4g %+8.1f%%  %s" % (metric, baseline[metric], stats[metric], change*100., status))
+        if is_failed:
+            failures.append("%s: %s changed by %+.1f%% (tolerance %.0f%%)" % (name, metric, change*100., tolerance*100.))
+    return failures
+
+def read_hists(file_name):
+    hists = {}
+    file = ROOT.TFile(file_name)
+    if not file or file.IsZombie():
+        return None
+    for key in file.GetListOfKeys():
+        if key.GetClassName() == "TH1D":
+            hists[key.GetName()] = key.ReadObj()
+    file.Close()
+    return hists
+
+#chi2 test of every histogram of the reference file with the same histogram of the new file
+def check_hists(name, file_name, reference_file_name):
+    reference = read_hists(reference_file_name)
+    current = read_hists(file_name)
+    if reference is None:
+        return [name + ": reference file " + reference_file_name + " cannot be read"]
+    if current is None:
+        return [name + ": file " + file_name + " cannot be read"]
+
+    failures = []
+    for hist_name, reference_hist in reference.items():
+        if hist_name not in current:
+            failures.append(name + ": histogram " + hist_name + " is missing")
+            continue
+        hist = current[hist_name]
+        if hist.GetNbinsX() != reference_hist.GetNbinsX():
+            failures.append(name + ": histogram " + hist_name + " has different binning")
+            continue
+
+        chi2, ndf, is_identical = 0., 0, True
+        for i in range(1, hist.GetNbinsX() + 1):
+            value, reference_value = hist.GetBinContent(i), reference_hist.GetBinContent(i)
+            error2 = hist.GetBinError(i)**2 + reference_hist.GetBinError(i)**2
+            if value != reference_value:
+                is_identical = False
+            if error2 <= 0.:
+                if value != reference_value:
+                    chi2, ndf = float("inf"), ndf + 1
+                continue
+            chi2 += (value - reference_value)**2/error2
+            ndf += 1
+
+        probability = ROOT.TMath.Prob(chi2, ndf) if ndf > 0 and chi2 != float("inf") else float(chi2 == 0.)
+        is_failed = probability < min_probability
+        status = red + "FAIL" + reset if is_failed else green + ("identical" if is_identical else "ok") + reset
+        print("  %-28s chi2/ndf %10.3g/%-4d prob %8.3g  %s" % (hist_name, chi2, ndf, probability, status))
+        if is_failed:
+            failures.append("%s: histogram %s differs from the reference (chi2/ndf %.3g/%d)" %
+                (name, hist_name, chi2, ndf))
+    return failures
+
+def main():
+    parser = argparse.ArgumentParser(description="Performance and physics regression tests of analytic.exe and generate.exe")
+    parser.add_argument("--update", action="store_true", help="store the results as the new baseline")
+    parser.add_argument("--only", action="append", help="run only the configuration with this name")
+    parser.add_argument("--repeat", type=int, default=3, help="number of runs of every configuration (default 3)")
+    parser.add_argument("--time-tolerance", type=float, help="allowed relative slowdown")
+    parser.add_argument("--memory-tolerance", type=float, help="allowed relative growth of the peak memory")
+    args = parser.parse_args()
+
+    if args.time_tolerance is not None:
+        for metric in ["wall_time", "init_time", "events_per_second", "integrand_calls_per_second"]:
+            tolerances[metric][1] = args.time_tolerance
+    if args.memory_tolerance is not None:
+        tolerances["peak_memory"][1] = args.memory_tolerance
+
+    baseline_file_name = os.path.join(baseline_dir, "baseline.json")
+    baseline = {}
+    if os.path.exists(baseline_file_name):
+        with open(baseline_file_name) as file:
+            baseline = json.load(file)
+    elif not args.update:
+        print(red + "No baseline in " + baseline_dir + "; run python regression.py --update first" + reset)
+        sys.exit(1)
+
+    failures = []
+    for configuration in configurations:
+        name = configuration["name"]
+        if args.only and name not in args.only:
+            continue
+
+        print(name + ": " + " ".join(configuration["command"]))
+        stats, run_dir = run(configuration, args.repeat)
+        if stats is None:
+            failures.append(name + ": the program failed")
+            print("  " + red + "FAIL" + reset + " the program failed")
+            continue
+
+        reference_dir = os.path.join(baseline_dir, name)
+        if args.update:
+            baseline[name] = stats
+            os.makedirs(reference_dir, exist_ok=True)
+            for file_name in configuration["files"]:
+                shutil.copy(os.path.join(run_dir, file_name), reference_dir)
+            for metric, value in stats.items():
+                print("  %-28s %12.4g" % (metric, value))
+            continue
+
+        if name not in baseline:
+            failures.append(name + ": no baseline")
+            print("  " + red + "FAIL" + reset + " no baseline")
+            continue
+
+        print("  %-28s %12s %12s %9s" % ("metric", "baseline", "current", "change"))
+        failures += check_metrics(name, stats, baseline[name])
+        for file_name in configuration["files"]:
+            failures += check_hists(name, os.path.join(run_dir, file_name),
+                os.path.join(reference_dir, file_name))
+
+    if args.update:
+        os.makedirs(baseline_dir, exist_ok=True)
+        with open(baseline_file_name, "w") as file:
+            json.dump(baseline, file, indent=4, sort_keys=True)
+        print("Baseline was written into " + baseline_dir)
+        return
+
+    if len(failures) > 0:
+        print(red + "REGRESSION TESTS FAILED" + reset)
+        for failure in failures:
+            print(red + "  " + failure + reset)
+        sys.exit(1)
+    print(green + "All regression tests passed" + reset)
+
+main()